@@ -22,20 +22,29 @@
 #include "include/UserInterface.h"
 #include "include/BluetoothServer.h"
 #include "include/Page.h"
-#include "include/RunningAverage.h"
+#include "include/FilterBank.h"
 #include "include/Console.h"
 #include "include/OrgasmControl.h"
 #include "include/WiFiHelper.h"
 #include "include/UpdateHelper.h"
 #include "include/WebSocketHelper.h"
+#include "include/Sampler.h"
+#include "include/AdcCapture.h"
+#include "include/SessionRecorder.h"
+#include "include/MotorPattern.h"
+#include "include/AccessoryLink.h"
+#include "include/ConfigStore.h"
+#include "include/Boot.h"
+
+#include <esp_timer.h>
 
 uint8_t LED_Brightness = 13;
 
 // Declare LCD
 #ifdef NG_PLUS
-  Adafruit_SSD1306 display(128, 64);
+  PartialSSD1306 display(128, 64);
 #else
-  Adafruit_SSD1306 display(128, 64, &SPI, OLED_DC, OLED_RESET, OLED_CS);
+  PartialSSD1306 display(128, 64, &SPI, OLED_DC, OLED_RESET, OLED_CS);
 #endif
 
 UserInterface UI(&display);
@@ -67,13 +76,10 @@ void printDirectory(File dir, int numTabs) {
   }
 }
 
-void resetSD() {
-  // SD
+bool mountSD() {
   if(!SD.begin()) {
-    UI.drawSdIcon(0);
     Serial.println("Card Mount Failed");
-    loadDefaultConfig();
-    return;
+    return false;
   }
 
   uint8_t cardType = SD.cardType();
@@ -81,47 +87,182 @@ void resetSD() {
   Serial.print("SD Card Type: ");
   if(cardType == CARD_MMC){
       Serial.println("MMC");
-      UI.drawSdIcon(1);
   } else if(cardType == CARD_SD){
       Serial.println("SDSC");
-      UI.drawSdIcon(1);
   } else if(cardType == CARD_SDHC){
       Serial.println("SDHC");
-      UI.drawSdIcon(1);
   } else {
       Serial.println("UNKNOWN");
   }
 
   uint64_t cardSize = SD.cardSize() / (1024 * 1024);
   Serial.printf("SD Card Size: %lluMB\n", cardSize);
+  return true;
+}
+
+TaskHandle_t BackgroundLoopTask;
+
+void backgroundLoop(void*) {
+  for (;;) {
+    WebSocketHelper::tick();
+    SessionRecorder::tick();
+    ConfigStore::tick();
+    delay(1);
+  }
+}
+
+// Boot stages. Everything the control loop touches runs on its core (1), so
+// interrupts land there as before; the rest goes to core 0 with the radios.
+
+enum BootStageIndex {
+  STAGE_CONFIG,
+  STAGE_HARDWARE,
+  STAGE_DISPLAY,
+  STAGE_SAMPLER,
+  STAGE_SD,
+  STAGE_BACKGROUND,
+  STAGE_WIFI,
+  STAGE_WEBSOCKET,
+  STAGE_BLUETOOTH,
+  STAGE_COUNT
+};
+
+bool config_cached = false;
+bool sd_mounted = false;
+
+bool bootConfig() {
+  // Config saved last time, straight from flash:
+  config_cached = loadConfigFromCache();
+  if (config_cached) {
+    return true;
+  }
 
-  loadConfigFromSd();
+  // Otherwise everything waits for the card, like it always has:
+  sd_mounted = mountSD();
+  if (sd_mounted) {
+    loadConfigFromSd();
+  } else {
+    loadDefaultConfig();
+  }
+
+  return true;
 }
 
-void setupHardware() {
+bool bootHardware() {
   pinMode(BUTT_PIN, INPUT);
   pinMode(MOT_PWM_PIN, OUTPUT);
 
   if(!Hardware::initialize()) {
     Serial.println("Hardware initialization failed!");
-    for(;;){}
+    return false;
   }
 
+  return true;
+}
+
+bool bootDisplay() {
   if(!UI.begin()) {
     Serial.println("SSD1306 allocation failed");
-    for(;;){}
+    return false;
   }
+
+  // Go to the splash page:
+  Page::Go(&DebugPage, false);
+  return true;
 }
 
-TaskHandle_t BackgroundLoopTask;
+bool bootSampler() {
+  // Start sampling the sensor on its own clock, or by DMA:
+  if (Config.adc_capture_hz <= 0 || !AdcCapture::begin(Config.adc_capture_hz)) {
+    return Sampler::begin(Config.update_frequency_hz);
+  }
 
-void backgroundLoop(void*) {
-  for (;;) {
-    WebSocketHelper::tick();
-    delay(1);
+  return true;
+}
+
+bool bootSD() {
+  if (config_cached) {
+    sd_mounted = mountSD();
+  }
+
+  UI.drawSdIcon(sd_mounted ? 1 : 0);
+  if (!sd_mounted) {
+    return true;
+  }
+
+  MotorPatterns::loadFromSd();
+
+  // With config from flash, the card's copy is checked in the background:
+  if (config_cached) {
+    ConfigStore::reconcileSoon();
+  }
+
+  return true;
+}
+
+bool bootBackground() {
+  // Start background worker:
+  return xTaskCreatePinnedToCore(
+      backgroundLoop, /* Task function. */
+      "backgroundLoop",   /* name of task. */
+      10000,     /* Stack size of task */
+      NULL,      /* parameter of the task */
+      1,         /* priority of the task */
+      &BackgroundLoopTask,    /* Task handle to keep track of created task */
+      0) == pdPASS;        /* pin task to core 0 */
+}
+
+bool bootWiFi() {
+  // Only starts connecting; WiFiHelper::tick() sees it through, and retries:
+  WiFiHelper::begin();
+  return true;
+}
+
+bool bootWebSocket() {
+  if (Config.wifi_on) {
+    WebSocketHelper::begin();
   }
+
+  return true;
 }
 
+bool bootBluetooth() {
+  if (!Config.bt_on) {
+    return true;
+  }
+
+  Serial.println("Starting up Bluetooth...");
+  BT.begin();
+  Serial.println("Now Discoverable!");
+  BT.advertise();
+  return true;
+}
+
+const BootStage boot_stages[] = {
+  // In BootStageIndex order. The display and SD card share a bus with the
+  // digipot and each other, so they take turns: hardware, display, card.
+  // WiFi and Bluetooth share the radio, and bring-up goes one at a time too.
+  { "config",     bootConfig,     0,                              0 },
+  { "hardware",   bootHardware,   BOOT_STAGE(STAGE_CONFIG),       1 },
+  { "display",    bootDisplay,    BOOT_STAGE(STAGE_HARDWARE),     1 },
+  { "sampler",    bootSampler,    BOOT_STAGE(STAGE_HARDWARE),     1 },
+  { "sd",         bootSD,         BOOT_STAGE(STAGE_DISPLAY),      0 },
+  { "background", bootBackground, BOOT_STAGE(STAGE_SD),           0 },
+  { "wifi",       bootWiFi,       BOOT_STAGE(STAGE_CONFIG),       0 },
+  { "websocket",  bootWebSocket,  BOOT_STAGE(STAGE_WIFI),         0 },
+  { "bluetooth",  bootBluetooth,  BOOT_STAGE(STAGE_WIFI),         0 },
+};
+
+static_assert(sizeof(boot_stages) / sizeof(BootStage) == STAGE_COUNT, "One boot stage per BootStageIndex.");
+
+// What the control loop needs before its first tick. Patterns come off the
+// card and are looked up by the loop, so that's in here too.
+#define BOOT_LOOP_STAGES (BOOT_STAGE(STAGE_HARDWARE) | BOOT_STAGE(STAGE_DISPLAY) | \
+                          BOOT_STAGE(STAGE_SAMPLER) | BOOT_STAGE(STAGE_SD))
+
+// I'm always one for the dramatics:
+#define SPLASH_MS 3000
+
 void setup() {
   // Start Serial port
   Serial.begin(115200);
@@ -133,55 +274,43 @@ void setup() {
 #endif
   Serial.println("Version: " VERSION);
 
-  // Setup Hardware
-  setupHardware();
-
-  // Go to the splash page:
-  Page::Go(&DebugPage, false);
+  Boot::begin(boot_stages, STAGE_COUNT);
 
-  // Setup SD, which loads our config
-  resetSD();
+  // WiFi and Bluetooth carry on in the background from here:
+  if (!Boot::waitFor(BOOT_LOOP_STAGES)) {
+    Serial.println("Boot failed!");
+    for(;;){}
+  }
 
   UI.drawWifiIcon(1);
   UI.render();
 
-  // Initialize WiFi
-  if (Config.wifi_on) {
-    WiFiHelper::begin();
-    WebSocketHelper::begin();
-  }
+  Serial.printf("READY in %ld ms\n", (long) (esp_timer_get_time() / 1000));
+}
 
-  // Initialize Bluetooth
-  if (Config.bt_on) {
-    Serial.println("Starting up Bluetooth...");
-    BT.begin();
-    Serial.println("Now Discoverable!");
-    BT.advertise();
+/**
+ * Leaves the splash page once it's had its moment, without holding up the
+ * loop meanwhile. Hold Key1 for fast boot, used in testing.
+ */
+void tickSplash() {
+  static bool splash = true;
+  if (!splash) {
+    return;
   }
 
-  // Start background worker:
-  xTaskCreatePinnedToCore(
-      backgroundLoop, /* Task function. */
-      "backgroundLoop",   /* name of task. */
-      10000,     /* Stack size of task */
-      NULL,      /* parameter of the task */
-      1,         /* priority of the task */
-      &BackgroundLoopTask,    /* Task handle to keep track of created task */
-      0);        /* pin task to core 0 */
-
-  // I'm always one for the dramatics:
-  // Hold Key1 for fast boot, used in testing.
 #ifdef KEY_1_PIN
-  if (digitalRead(KEY_1_PIN) == HIGH) {
+  bool fast_boot = digitalRead(KEY_1_PIN) == LOW;
 #else
-  if (true) {
+  bool fast_boot = false;
 #endif
-    delay(3000);
-    UI.fadeTo();
-  }
 
-  Page::Go(&RunGraphPage);
-  Serial.println("READY");
+  if (fast_boot || millis() > SPLASH_MS) {
+    splash = false;
+    if (!fast_boot) {
+      UI.fadeTo();
+    }
+    Page::Go(&RunGraphPage);
+  }
 }
 
 void loop() {
@@ -189,17 +318,16 @@ void loop() {
   Hardware::tick();
   OrgasmControl::tick();
   UI.tick();
+  tickSplash();
+
+  // WebSocket clients are streamed to from the background loop:
+  if (OrgasmControl::updated()) {
+    AccessoryLink::sendReadings(OrgasmControl::getLastPressure(), OrgasmControl::getArousal());
+  }
 
-  static long lastStatusTick = 0;
   static long lastTick = 0;
   static int led_i = 0;
 
-  // Periodically send out WiFi status:
-  if (millis() - lastStatusTick > 1000 * 10) {
-    lastStatusTick = millis();
-    WebSocketHelper::sendWxStatus();
-  }
-  
   if (millis() - lastTick > 1000/15) {
     lastTick = millis();
 
@@ -220,9 +348,9 @@ void loop() {
     Hardware::ledShow();
 #endif
 
-    // Update Icons
+    // Reconnect WiFi if need be, and update Icons
+    WiFiHelper::tick();
     WiFiHelper::drawSignalIcon();
-    WebSocketHelper::sendReadings();
   }
 
   Page::DoLoop();
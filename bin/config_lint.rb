@@ -1,6 +1,6 @@
 #!/usr/bin/env ruby
 #
-# Config is pretty spread out right now, so this lints it up.
+# Checks the config schema table against ConfigStruct and the README.
 
 DIR = File.expand_path(File.join(File.dirname(__FILE__), ".."))
 puts "IN: #{DIR}"
@@ -41,166 +41,54 @@ def error(file, line, message)
   $errors.push({ file: file, line: (line || -1) + 1, message: message })
 end
 
-# Now grep config.cpp for valid JSON read/writes:
+# Now read the schema table, which drives loading, saving and the console:
 
-json_assignments = []
-json_reads = []
+schema_keys = []
 json_defaults = {}
+last_key = nil
 
-config_cpp = File.join(DIR, "src", "config.cpp");
-File.foreach(config_cpp).with_index do |line, i|
-  # Check Read
-  if line =~ /Config\.(\w+)\s*=\s*doc\["(\w+)"\](\s*\|\s*\S+)?/
-    json_reads << $2
-    type = config_values[$1]
-    if $1 != $2
-      error config_cpp, i, "JSON read #{$2.inspect} does not match config key #{$1.inspect}"
-    end
-    if type.nil?
-      error config_cpp, i, "JSON read #{$2.inspect} to unknown key"
-    end
-    if $3.nil? || $3 == ""
-      error config_cpp, i, "JSON read #{$2.inspect} missing default value for #{type.inspect}"
-    else
-      json_defaults[$1] = $3.gsub(/\s*\|\s*/, '').gsub(/;\s*$/, '')
-    end
-    if type =~ /String|char\[\d+\]/
-      error config_cpp, i, "JSON assigns #{$2.inspect} to string type! Use strlcpy!"
-    end
-  end
+schema_cpp = File.join(DIR, "src", "ConfigSchema.cpp")
+File.foreach(schema_cpp).with_index do |line, i|
+  next unless line =~ /^\s*CONFIG_(BOOL|BYTE|INT|STRING)\(\s*(\w+)\s*,\s*("[^"]*"|[^,]+)/
 
-  # Check String Reads
-  if line =~ /strlcpy\s*\(\s*Config\.(\w+)\s*,\s*doc\["(\w+)"\]\s*(|.*?)?,\s*sizeof\s*\(\s*Config\.(\w+)/
-    type = config_values[$1]
-    json_reads << $2
-    if $1 != $2
-      error config_cpp, i, "JSON read #{$2.inspect} does not match config key #{$1.inspect}"
-    end
-    if $1 != $4
-      error config_cpp, i, "JSON read #{$2.inspect} has mismatched config key #{$4.inspect} in sizeof() call"
-    end
-    if type.nil?
-      error config_cpp, i, "JSON read #{$2.inspect} to unknown key"
-    end
-    if $3.nil? || $3 == ""
-      error config_cpp, i, "JSON read #{$2.inspect} missing default value for #{type.inspect}"
-    else
-      json_defaults[$1] = $3.gsub(/\s*\|\s*/, '').gsub(/;\s*$/, '')
-    end
-    if type !~ /String|char\[\d+\]/
-      error config_cpp, i, "JSON assigns #{$2.inspect} as string, but the type should be #{type.inspect}"
-    end
-  end
+  macro = $1
+  key = $2
+  default = $3.strip
+  type = config_values[key]
 
-  # Check Assignment
-  if line =~ /doc\s*\[\"(\w+)\"\]\s*=\s*Config\.(\w+)/
-    type = config_values[$2]
-    json_assignments << $1
-    if $1 != $2
-      error config_cpp, i, "JSON assignment #{$1.inspect} does not match config key #{$2.inspect}"
-    end
-    if type.nil?
-      error config_cpp, i, "JSON assignment #{$1.inspect} from unknown key"
-    end
+  if type.nil?
+    error schema_cpp, i, "Schema entry for unknown key #{key.inspect}"
   end
-end
-
-# Check Missing Assignments
-(config_values.keys - json_assignments).each do |value|
-  error config_cpp, nil, "Missing JSON assignment for #{value.inspect}"
-end
-
-# Check Missing Reads
-(config_values.keys - json_reads).each do |value|
-  error config_cpp, nil, "Missing JSON read for #{value.inspect}"
-end
 
-console_checks = []
-console_gets = []
-console_sets = []
-last_check = ""
-
-# Check Console.cpp, which will soon move to config.cpp
-console_cpp = File.join(DIR, "src", "config.cpp")
-File.foreach(console_cpp).with_index do |line, i|
-  if line =~ /strcmp\s*\(\s*option\s*,\s*"(\w+)"/
-    console_checks << $1
-    last_check = $1
-    next
-  elsif last_check == ""
-    next
+  if schema_keys.include?(key)
+    error schema_cpp, i, "Duplicate schema entry for #{key.inspect}"
   end
 
-  if line =~ /String\s*\(\s*Config\.(\w+)/
-    console_gets << $1
-    type = config_values[$1]
-    if ($1 != last_check)
-      error console_cpp, i, "Config value #{$1.inspect} does not match last checked key #{last_check.inspect}"
-    end
-    if type.nil?
-      error console_cpp, i, "Read unknown key #{$1.inspect} from Config"
-    end
+  if !last_key.nil? && key < last_key
+    error schema_cpp, i, "Schema entry #{key.inspect} is out of order, it goes before #{last_key.inspect}"
   end
 
-  if line =~ /Config\.(\w+)\s*=\s*(.*?);/
-    console_sets << $1
-    type = config_values[$1]
-    if ($1 != last_check)
-      error console_cpp, i, "Config value #{$1.inspect} does not match last checked key #{last_check.inspect}"
-    end
-    if type.nil?
-      error console_cpp, i, "Setting unknown key #{$1.inspect} to Config"
-    end
-    option = $1
-    setter = $2
-    case type
-    when "bool"
-      if $2 !~ /atob\s*\(/
-        error console_cpp, i, "Config option #{option.inspect} is #{type}, use atob()"
-      end
-    when /int|byte|char/
-      if setter !~ /atoi\s*\(/
-        error console_cpp, i, "Config option #{option.inspect} is #{type}, use atoi()"
-      end
-    else
-      error console_cpp, i, "Config option #{option.inspect} using invalid setter"
-    end
+  expected = case type
+  when /char\[|String/
+    "STRING"
+  when "bool"
+    "BOOL"
+  else
+    type.to_s.upcase
   end
 
-  if line =~ /strlcpy\s*\(\s*Config\.(\w+)\s*,\s*value\s*,\s*sizeof\s*\(\s*Config\.(\w+)/
-    type = config_values[$1]
-    console_sets << $1
-    lval = $1
-    if $1 != $2
-      error console_cpp, i, "Console read #{$1.inspect} has mismatched config key #{$2.inspect} in sizeof() call"
-    end
-    if ($1 != last_check)
-      error console_cpp, i, "Config value #{$1.inspect} does not match last checked key #{last_check.inspect}"
-    end
-    if type.nil?
-      error console_cpp, i, "Console read #{$1.inspect} to unknown key"
-    end
-    if type !~ /String|char\[\d+\]/
-      error console_cpp, i, "Console assigns #{lval.inspect} as string, but the type should be #{type.inspect}"
-    end
+  if !type.nil? && macro != expected
+    error schema_cpp, i, "Schema entry #{key.inspect} uses CONFIG_#{macro}, but the type is #{type.inspect}"
   end
 
-  last_check = ""
+  schema_keys << key
+  json_defaults[key] = default
+  last_key = key
 end
 
-# Check Missing Checks
-(config_values.keys - console_checks).each do |value|
-  error console_cpp, nil, "Missing Console check for #{value.inspect}"
-end
-
-# Check Missing Gets
-(config_values.keys - console_gets).each do |value|
-  error console_cpp, nil, "Missing Console get for #{value.inspect}"
-end
-
-# Check Missing Sets
-(config_values.keys - console_sets).each do |value|
-  error console_cpp, nil, "Missing Console set for #{value.inspect}"
+# Check Missing Entries
+(config_values.keys - schema_keys).each do |value|
+  error schema_cpp, nil, "Missing schema entry for #{value.inspect}"
 end
 
 #== Check Readme
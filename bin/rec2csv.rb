@@ -0,0 +1,67 @@
+#!/usr/bin/env ruby
+#
+# Converts binary session recordings (log-*.rec, see include/SessionRecorder.h)
+# to the CSV layout recordings used before, next to the original file.
+#
+#   ruby bin/rec2csv.rb /Volumes/SD/log-20200101-120000.rec [...]
+
+MAGIC = "EOMR".freeze
+FORMAT_VERSION = 2
+CSV_HEADER = "millis,pressure,avg_pressure,arousal,motor_speed,sensitivity_threshold,baseline".freeze
+
+# RecordingHeader: magic, version, header_size, record_size, update_frequency_hz, start_millis
+HEADER_FORMAT = "a4 v v v v V".freeze
+HEADER_LENGTH = 16
+
+# Reading: millis, pressure, avg_pressure, arousal, motor_speed, flags, sensitivity_threshold, baseline
+# (baseline was reserved, and zero, before version 2)
+READING_FORMAT = "V v v v C C v v".freeze
+READING_LENGTH = 16
+
+if ARGV.empty?
+  $stderr.puts "Usage: #{$0} <recording.rec> [...]"
+  exit 2
+end
+
+status = 0
+
+ARGV.each do |path|
+  data = File.binread(path)
+  magic, version, header_size, record_size, hz, start_millis = data.unpack(HEADER_FORMAT)
+
+  if data.length < HEADER_LENGTH || magic != MAGIC
+    $stderr.puts "#{path}: not a session recording"
+    status = 1
+    next
+  end
+
+  if version > FORMAT_VERSION || record_size < READING_LENGTH
+    $stderr.puts "#{path}: unsupported recording version #{version}"
+    status = 1
+    next
+  end
+
+  out_path = path.sub(/\.rec\z/i, "") + ".csv"
+  count = 0
+
+  File.open(out_path, "w") do |out|
+    out.puts CSV_HEADER
+
+    offset = header_size
+    while offset + record_size <= data.length
+      millis, pressure, avg_pressure, arousal, motor_speed, _flags, threshold, baseline =
+        data.byteslice(offset, READING_LENGTH).unpack(READING_FORMAT)
+      offset += record_size
+
+      # Sectors are zero padded if a record doesn't fit the tail
+      next if millis == 0
+
+      out.puts [millis - start_millis, pressure, avg_pressure, arousal, motor_speed, threshold, baseline].join(",")
+      count += 1
+    end
+  end
+
+  puts "#{path}: #{count} samples at #{hz} Hz -> #{out_path}"
+end
+
+exit status
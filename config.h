@@ -21,7 +21,9 @@
 
 // Butt Pin
 #define BUTT_PIN        34
+#define BUTT_ADC_CHANNEL ADC1_CHANNEL_6 // BUTT_PIN, for I2S ADC capture
 #define MOT_PWM_PIN     15
+#define MOT_PWM_CHANNEL 15 // LEDC, clear of the ones analogWrite() hands out
 
 // SD Connections
 #define SD_CS_PIN       5
@@ -91,6 +93,7 @@ struct ConfigStruct {
   byte led_brightness;
   int screen_dim_seconds;
   int screen_timeout_seconds;
+  int screen_max_fps;
 
   // Server
   int websocket_port;
@@ -98,20 +101,44 @@ struct ConfigStruct {
 
   // Orgasms and Stuff
   byte motor_max_speed;
+  int motor_pwm_hz;
+  int motor_slew_ms;
+  char motor_profile[16];
+  char motor_pattern[16];
+  char accessory_scale[64];
   byte pressure_smoothing;
   int sensitivity_threshold;
   int motor_ramp_time_s;
   int update_frequency_hz;
   byte sensor_sensitivity;
+  byte pressure_oversampling;
+  int adc_capture_hz;
   bool use_average_values;
+  int baseline_window_s;
+  int edge_lead_ms;
+  bool auto_calibrate;
+  char arousal_detector[16];
+  char pressure_filter[16];
 } extern Config;
 
+// A set of config keys, a bit per schema index. See ConfigSchema.h.
+typedef uint64_t ConfigKeySet;
+#define CONFIG_ALL_KEYS (~(ConfigKeySet) 0)
+
 extern void loadConfigFromSd();
+extern bool loadConfigFromCache();
 extern void loadDefaultConfig();
 extern void loadConfigFromJsonObject(JsonDocument &doc);
+// Just the keys in `doc`, over what `to` already holds.
+extern void loadConfigFromJsonObject(JsonDocument &doc, ConfigStruct &to);
 extern void saveConfigToSd(long save_at_ms = -1);
 extern bool setConfigValue(const char *key, const char *value, bool &require_reboot);
+// setConfigValue() in two halves, so a batch of keys is acted on once:
+// storeConfigValue() collects each key's CONFIG_* flags in `changed`.
+extern bool storeConfigValue(const char *key, const char *value, uint8_t &changed);
+extern void applyConfigChanges(uint8_t changed, bool &require_reboot);
 extern bool getConfigValue(const char *key, String &out);
 extern void dumpConfigToJsonObject(JsonDocument &doc);
+extern void dumpConfigToJsonObject(JsonDocument &doc, const ConfigStruct &from, ConfigKeySet keys);
 extern bool dumpConfigToJson(String &str);
 #endif
\ No newline at end of file
@@ -16,4 +16,9 @@
  */
 #define E_SAV_SER "E_SAV_SER"
 
+/**
+ * Failed to append changed settings to the config journal.
+ */
+#define E_SAV_LOG "E_SAV_LOG"
+
 #endif
\ No newline at end of file
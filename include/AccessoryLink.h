@@ -0,0 +1,121 @@
+#ifndef __AccessoryLink_h
+#define __AccessoryLink_h
+
+#include <Arduino.h>
+#include "../config.h"
+
+// Accessories the link keeps track of at once.
+#define ACCESSORY_MAX_DEVICES 8
+
+// Range scanned for accessories, skipping our own parts on the bus.
+#define ACCESSORY_SCAN_FIRST 0x08
+#define ACCESSORY_SCAN_LAST 0x77
+#define ACCESSORY_DIGIPOT_ADDR 0x2F
+
+// Where an accessory is assumed to be until a scan finds otherwise.
+#ifdef I2C_SLAVE_ADDR
+#define ACCESSORY_DEFAULT_ADDR I2C_SLAVE_ADDR
+#else
+#define ACCESSORY_DEFAULT_ADDR 0x09
+#endif
+
+// Least time between bursts; anything queued in between is coalesced.
+#define ACCESSORY_BURST_INTERVAL_MS 20
+
+// Retry delay after a failed send, doubling up to the max, per accessory.
+#define ACCESSORY_RETRY_MIN_MS 20
+#define ACCESSORY_RETRY_MAX_MS 2000
+
+// Failures in a row before an accessory is reported down.
+#define ACCESSORY_DOWN_AFTER 5
+
+// How long the control loop will wait for the bus, for the digipot.
+#define ACCESSORY_BUS_WAIT_MS 50
+
+/**
+ * Opcodes, as the accessory receives them. A frame holds one or more of
+ * these back to back, each followed by its arguments; values are big endian.
+ */
+#define ACCESSORY_OP_MOTOR_SPEED 0x10   // speed (1)
+#define ACCESSORY_OP_READINGS    0x11   // pressure (2), arousal (2)
+
+enum AccessoryLinkState {
+  AccessoryLinkIdle,
+  AccessoryLinkOk,
+  AccessoryLinkRetrying,
+  AccessoryLinkDown
+};
+
+typedef struct Accessory {
+  uint8_t address;
+  // Percent of the motor speed this one runs at.
+  uint8_t scale;
+  uint32_t sent;
+  uint32_t failed;
+  uint32_t consecutive_failures;
+  uint8_t last_error;
+  uint32_t last_ok_ms;
+} Accessory;
+
+typedef struct AccessoryLinkStats {
+  uint32_t queued;
+  uint32_t coalesced;
+  uint32_t bursts;
+  uint32_t scans;
+  uint32_t last_burst_us;
+  uint32_t max_burst_us;
+} AccessoryLinkStats;
+
+/**
+ * Mirrors the motor speed and readings to accessories on the external I2C
+ * bus, without the control loop ever touching the bus for it.
+ *
+ * sendSpeed() and sendReadings() only mark what changed and wake a low
+ * priority task on core 0. At most every ACCESSORY_BURST_INTERVAL_MS, the
+ * task takes the bus once and writes one frame to each accessory that has
+ * something new, back to back, with its own scaled speed. Whatever changed
+ * more than once in between goes out once, as the latest value.
+ *
+ * An accessory that doesn't answer keeps what it missed and is retried after
+ * ACCESSORY_RETRY_MIN_MS, doubling every time up to ACCESSORY_RETRY_MAX_MS,
+ * without holding up the others.
+ *
+ * Accessories are found by scan(), which runs whenever the link goes active.
+ * Their speed scales come from accessory_scale, as "address:percent" pairs,
+ * e.g. "0x09:100,0x0a:50"; anything not listed runs at 100%.
+ *
+ * The digipot is on the same bus, so everything using Wire takes it through
+ * takeBus() / giveBus().
+ */
+namespace AccessoryLink {
+  bool begin();
+  void end();
+
+  // Active while we're bus master with the external bus enabled.
+  void setActive(bool active);
+  bool isActive();
+
+  // Queues values for every accessory, replacing any not yet sent.
+  void sendSpeed(byte speed);
+  void sendReadings(long pressure, long arousal);
+
+  // Re-enumerates accessories in the background.
+  void scan();
+
+  // Picks up accessory_scale.
+  void configChanged();
+
+  bool takeBus(uint32_t wait_ms = ACCESSORY_BUS_WAIT_MS);
+  void giveBus();
+
+  size_t getDeviceCount();
+  bool getDevice(size_t index, Accessory &device);
+  AccessoryLinkState getState(const Accessory &device);
+  const char *getStateName(AccessoryLinkState state);
+
+  void getStats(AccessoryLinkStats &stats);
+  void resetStats();
+  void printStats(String &out);
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef __AdcCapture_h
+#define __AdcCapture_h
+
+#include <Arduino.h>
+#include "SampleBlock.h"
+#include "SampleBuffer.h"
+
+// Blocks shared by the capture task and every consumer.
+#define ADC_CAPTURE_POOL_SIZE 8
+
+// Consumers, and blocks each may have waiting (one less than the size).
+#define ADC_CAPTURE_MAX_CONSUMERS 4
+#define ADC_CAPTURE_QUEUE_SIZE 4
+
+typedef struct CaptureStats {
+  uint32_t blocks;
+  uint32_t samples;
+  uint32_t overruns;
+} CaptureStats;
+
+/**
+ * Continuous pressure capture through the I2S peripheral's built-in ADC
+ * mode. DMA fills the samples in with no per-sample CPU cost, and a task on
+ * core 0 stamps each SampleBlock with the time of its first sample and hands
+ * it to every consumer.
+ *
+ * Blocks are shared, not copied: each consumer gets a reference to the same
+ * block, so all of them see the exact same samples. Consumers must drain
+ * their queue with receive() and release() every block they get, or the
+ * pool runs dry and capture starts dropping blocks.
+ *
+ * While this runs, ADC1 belongs to I2S; don't analogRead() BUTT_PIN.
+ *
+ * The pool is kept out of this header so each includer doesn't get a copy.
+ */
+namespace AdcCapture {
+  bool begin(uint32_t sample_rate_hz);
+  void end();
+  bool running();
+  uint32_t getSampleRate();
+
+  // Returns a consumer id for receive(), or -1 if there's no room.
+  int subscribe(const char *name);
+  bool receive(int consumer, SampleBlock *&block);
+  void release(SampleBlock *block);
+
+  void getStats(CaptureStats &stats);
+  void printStats(String &out);
+}
+
+#endif
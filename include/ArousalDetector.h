@@ -0,0 +1,74 @@
+#ifndef __ArousalDetector_h
+#define __ArousalDetector_h
+
+#include <Arduino.h>
+#include "../config.h"
+#include "FixedPoint.h"
+
+typedef struct DetectorStats {
+  uint32_t ticks;
+  uint32_t last_us;
+  uint32_t max_us;
+  uint64_t total_us;
+} DetectorStats;
+
+/**
+ * Turns the pressure signal into arousal.
+ *
+ * OrgasmControl owns arousal and its decay; once per control step it hands
+ * the selected detector a pressure value (raw or averaged, as configured)
+ * and adds whatever arousal the detector returns. Detectors keep their own
+ * state and read the threshold / rate from Config as they need.
+ */
+class ArousalDetector {
+public:
+  // Name used by the arousal_detector config key and the mode command.
+  virtual const char *getName() = 0;
+
+  // Forget all history, e.g. when switching to this detector.
+  virtual void reset() {}
+
+  /**
+   * Runs one step of detect(), timing it.
+   * @return arousal to add, in Q16.16
+   */
+  fixed_t update(long pressure) {
+    unsigned long start_us = micros();
+    fixed_t added = detect(pressure);
+    uint32_t cost_us = micros() - start_us;
+
+    stats.ticks++;
+    stats.last_us = cost_us;
+    stats.total_us += cost_us;
+    if (cost_us > stats.max_us) {
+      stats.max_us = cost_us;
+    }
+
+    return added;
+  }
+
+  const DetectorStats &getStats() { return stats; }
+  void resetStats() { stats = DetectorStats(); }
+
+protected:
+  virtual fixed_t detect(long pressure) = 0;
+
+private:
+  DetectorStats stats = {0};
+};
+
+namespace ArousalDetectors {
+  size_t count();
+  ArousalDetector *get(size_t index);
+  ArousalDetector *find(const char *name);
+
+  // Per-tick cost of every detector that has run.
+  void printStats(String &out, ArousalDetector *active = nullptr);
+}
+
+#include "../src/detectors/PeakDetector.h"
+#include "../src/detectors/SlopeDetector.h"
+#include "../src/detectors/BandEnergyDetector.h"
+#include "../src/detectors/AdaptiveDetector.h"
+
+#endif
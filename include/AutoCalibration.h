@@ -0,0 +1,91 @@
+#ifndef __AutoCalibration_h
+#define __AutoCalibration_h
+
+#include <Arduino.h>
+#include "../config.h"
+#include "Reading.h"
+
+// Observation before the first threshold is set.
+#define CAL_WARMUP_MS 60000
+
+// Peaks and baseline are measured per window, and adjustments happen once
+// per window.
+#define CAL_WINDOW_MS 5000
+
+// Where the resting (baseline) pressure should sit: ~65% of the ADC range.
+#define CAL_TARGET_PRESSURE 2660
+
+// Digipot bounds, and the most it moves per window.
+#define CAL_SENSITIVITY_MIN 16
+#define CAL_SENSITIVITY_MAX 255
+#define CAL_SENSITIVITY_STEP 4
+
+// Threshold is this many times the typical arousal peak...
+#define CAL_THRESHOLD_MARGIN 1.5f
+// ...moves at most this fraction per window once warmed up...
+#define CAL_THRESHOLD_STEP 0.05f
+// ...and stays within this factor of the warm-up value, and these bounds.
+#define CAL_THRESHOLD_RANGE 2.0f
+#define CAL_THRESHOLD_MIN 50
+#define CAL_THRESHOLD_MAX 4000
+
+// The typical peak is the highest recent window peak, fading by this much
+// per window so it can come down again.
+#define CAL_PEAK_DECAY 0.98f
+
+enum CalibrationState {
+  CalibrationOff,
+  CalibrationWarmUp,
+  CalibrationTracking
+};
+
+/**
+ * Calibrates sensitivity_threshold and sensor_sensitivity from the session
+ * itself.
+ *
+ * Warm-up watches CAL_WARMUP_MS of control steps, skipping the first window
+ * while the plug settles. Each window, the digipot is stepped toward putting
+ * the resting pressure at CAL_TARGET_PRESSURE, and the window's peak arousal
+ * is noted. At the end of warm-up the threshold is set to
+ * CAL_THRESHOLD_MARGIN times the highest peak.
+ *
+ * After that it keeps tracking, slowly and within bounds: the digipot
+ * follows baseline drift, and the threshold follows the (fading) highest
+ * peak, but only from windows that stayed under the threshold with no
+ * denial, so it never chases an edge upward.
+ */
+namespace AutoCalibration {
+  void start();
+  void stop();
+  CalibrationState getState();
+  bool active();
+
+  // Called by OrgasmControl after every control step.
+  void update(const Reading &reading);
+
+  void printStatus(String &out);
+
+  namespace {
+    CalibrationState state = CalibrationOff;
+    long started_ms = 0;
+    long window_start_ms = 0;
+
+    // Current window
+    long window_min_pressure = 0;
+    long window_peak_arousal = 0;
+    int window_denials = 0;
+
+    // Long term estimates
+    float baseline = 0;
+    float typical_peak = 0;
+    int windows = 0;
+    int warmup_threshold = 0;
+
+    void endWindow(long now_ms);
+    void adjustSensitivity();
+    void adjustThreshold();
+    void resetWindow(long now_ms);
+  }
+}
+
+#endif
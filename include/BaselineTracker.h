@@ -0,0 +1,48 @@
+#ifndef __BaselineTracker_h
+#define __BaselineTracker_h
+
+#include "Arduino.h"
+#include "FixedPoint.h"
+
+// The window is tracked as this many block minima, so it slides in steps of
+// one block instead of needing the whole window of history.
+#define BASELINE_BLOCKS 8
+
+/**
+ * Follows the resting pressure under the contractions: the minimum over a
+ * long sliding window, which rides out slow drift from the plug inflating or
+ * warming up, but not the contractions themselves, which only add pressure.
+ *
+ * The window minimum steps whenever a block slides out of it, so the output
+ * follows it through an EMA with a time constant of one block. That keeps
+ * the steps from looking like contractions to anything downstream.
+ *
+ * Not thread safe: setWindow() and reset() belong on the task that adds
+ * values.
+ */
+class BaselineTracker {
+public:
+  void addValue(long value);
+  void reset();
+
+  long get() { return fixed_round(baseline); }
+
+  // Window length, in samples.
+  void setWindow(size_t samples);
+  size_t getWindow() { return block_size * BASELINE_BLOCKS; }
+
+private:
+  long minima[BASELINE_BLOCKS] = {0};
+  uint8_t block = 0;
+  size_t block_size = 1;
+  size_t block_fill = 0;
+  bool primed = false;
+
+  // Q16.16
+  fixed_t baseline = 0;
+  fixed_t alpha = FIXED_ONE;
+
+  long windowMinimum();
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef __Boot_h
+#define __Boot_h
+
+#include <Arduino.h>
+
+// Stages in one boot; each is a bit in an event group.
+#define BOOT_MAX_STAGES 16
+
+#define BOOT_STAGE_STACK 8192
+
+// Bit for a stage's index, for BootStage::after and Boot::waitFor().
+#define BOOT_STAGE(index) ((uint32_t) 1 << (index))
+
+/**
+ * One step of startup. It runs once every stage in `after` has finished, on
+ * its own task pinned to `core`, and returns false if it failed. Stages that
+ * attach interrupts belong on the core the control loop runs on.
+ */
+typedef struct BootStage {
+  const char *name;
+  bool (*run)();
+  uint32_t after;
+  BaseType_t core;
+} BootStage;
+
+enum BootStageState : uint8_t {
+  BootStagePending,
+  BootStageRunning,
+  BootStageDone,
+  BootStageFailed,
+  BootStageSkipped
+};
+
+/**
+ * Runs a table of boot stages as early as their dependencies allow, each on
+ * its own short-lived task, so a slow one (WiFi, Bluetooth) only holds up
+ * what actually needs it. A stage whose dependency failed is skipped.
+ *
+ * Every stage's start and end are kept, in microseconds since reset, and
+ * printed to Serial once the last one finishes; see the .boot command.
+ */
+namespace Boot {
+  // Starts every stage with nothing to wait for. `stages` must outlive boot.
+  void begin(const BootStage *stages, size_t count);
+
+  // Blocks until every stage in `stages` is through. Returns false if any of
+  // them failed or was skipped.
+  bool waitFor(uint32_t stages);
+
+  bool finished();
+  BootStageState getState(size_t index);
+
+  void printReport(String &out);
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef __ConfigSchema_h
+#define __ConfigSchema_h
+
+#include <Arduino.h>
+#include "../config.h"
+
+// What has to happen when a key changes, on top of OrgasmControl::configChanged().
+#define CONFIG_REBOOT      0x01
+#define CONFIG_MOTOR       0x02
+#define CONFIG_ACCESSORIES 0x04
+#define CONFIG_SENSITIVITY 0x08
+#define CONFIG_CALIBRATION 0x10
+
+enum ConfigType : uint8_t {
+  ConfigBool,
+  ConfigByte,
+  ConfigInt,
+  ConfigString
+};
+
+/**
+ * One ConfigStruct field: where it lives, how to parse it, and its default
+ * and range. Strings only use default_string, the rest only default_value.
+ */
+typedef struct ConfigKey {
+  const char *key;
+  ConfigType type;
+  uint8_t flags;
+  uint16_t offset;
+  uint16_t size;
+  long default_value;
+  const char *default_string;
+  long min;
+  long max;
+} ConfigKey;
+
+/**
+ * Every config key, in one table sorted by key. Loading, saving, the console
+ * and the web UI all go through it, so a field added to ConfigStruct needs
+ * exactly one line there, and lookups are a binary search.
+ *
+ * The table is constexpr and checked at compile time: keys must be sorted
+ * and unique, defaults in range, and each entry's macro must match its
+ * field's type.
+ */
+namespace ConfigSchema {
+  size_t count();
+  const ConfigKey *get(size_t index);
+  const ConfigKey *find(const char *key);
+
+  // Changes whenever a key is added, removed, renamed or retyped, so a
+  // ConfigStruct saved as raw bytes can tell if it still fits.
+  uint32_t version();
+
+  void loadDefaults();
+
+  // Stores a value, clamped to the key's range (or truncated, for strings).
+  void setLong(const ConfigKey &key, long value, ConfigStruct &to = Config);
+  void setString(const ConfigKey &key, const char *value, ConfigStruct &to = Config);
+
+  // Clamps every value and terminates every string, for a ConfigStruct read
+  // back as raw bytes.
+  void validate(ConfigStruct &to);
+
+  // Parses a value as typed in the console or sent by the web UI.
+  void parse(const ConfigKey &key, const char *value);
+
+  long getLong(const ConfigKey &key, const ConfigStruct &from = Config);
+  const char *getString(const ConfigKey &key, const ConfigStruct &from = Config);
+  void print(const ConfigKey &key, String &out);
+
+  // Keys whose values differ between `a` and `b`.
+  ConfigKeySet diff(const ConfigStruct &a, const ConfigStruct &b);
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef __ConfigStore_h
+#define __ConfigStore_h
+
+#include <Arduino.h>
+#include "../config.h"
+
+// Changed keys since config.json was last written, one JSON object per line.
+#define CONFIG_JOURNAL_FILENAME "/config.log"
+#define CONFIG_TEMP_FILENAME "/config.tmp"
+#define CONFIG_BACKUP_FILENAME CONFIG_FILENAME ".bak"
+
+// Journal entries before they're folded back into config.json.
+#define CONFIG_JOURNAL_MAX_ENTRIES 50
+
+// Wait before trying again after the SD card failed a write.
+#define CONFIG_STORE_RETRY_MS 5000
+
+// Where the last saved ConfigStruct is kept in flash, see loadCached().
+#define CONFIG_NVS_NAMESPACE "config"
+
+/**
+ * Config persistence, off the UI loop.
+ *
+ * commit() is all the loop does: it works out which keys changed since the
+ * last commit, and hands a snapshot to the background task. There, tick()
+ * appends just those keys to CONFIG_JOURNAL_FILENAME as one short line. Every
+ * CONFIG_JOURNAL_MAX_ENTRIES lines, the whole config is written to a temp
+ * file, renamed over config.json (keeping the old one as .bak), and the
+ * journal is dropped.
+ *
+ * Nothing is ever rewritten in place, so a crash or power cut leaves either
+ * the old state or the new one: load() finishes an interrupted compaction,
+ * and ignores a journal line that was cut short.
+ *
+ * Every saved config is also kept as raw bytes in NVS flash, tagged with the
+ * schema version. Booting from that takes microseconds and needs no card; the
+ * card's copy is then read in the background and whatever was changed there
+ * (by hand, say) is handed back to the loop through takeReconciled(). With no
+ * card at all, saves only go to flash.
+ */
+namespace ConfigStore {
+  // Reads config.json (or what a cut short compaction left of it) and the
+  // journal into `doc`. Returns false if there was no config at all.
+  bool load(JsonDocument &doc);
+
+  // Takes the config as it is now as what's on the card, after loading.
+  void markSaved();
+
+  // Loads the flash copy into Config, if there is one from this schema
+  // version. Call before the background task starts.
+  bool loadCached();
+
+  // Reads the card's config on the next tick, for takeReconciled().
+  void reconcileSoon();
+
+  // Loop side. Once the card's config is read, fills `from_sd` with it and
+  // returns the keys where it differs from Config, leaving out any changed
+  // here since boot.
+  ConfigKeySet takeReconciled(ConfigStruct &from_sd);
+
+  // Loop side. Queues whatever changed since the last commit, and returns it.
+  ConfigKeySet commit();
+
+  // Folds the journal into config.json on the next tick.
+  void compactSoon();
+
+  // Background side, does the writing.
+  void tick();
+
+  // The last write error, once, for the loop to report.
+  const char *takeError();
+
+  void printStatus(String &out);
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef __FilterBank_h
+#define __FilterBank_h
+
+#include "Arduino.h"
+
+// Samples of history kept for the windowed stages. Covers any byte sized
+// window.
+#define FILTER_HISTORY 256
+
+// Median-of-N gets expensive fast, so it's capped below the window.
+#define FILTER_MEDIAN_MAX 15
+
+enum FilterStage {
+  FilterBoxcar,
+  FilterEma,
+  FilterMedian,
+  FilterLowPass,
+  FILTER_STAGES
+};
+
+/**
+ * Runs a set of smoothing filters side by side over one sample stream:
+ *
+ *  - boxcar:  running mean of the last `window` samples
+ *  - ema:     exponential average, alpha = 2 / (window + 1)
+ *  - median:  median of the last min(window, FILTER_MEDIAN_MAX) samples
+ *  - lowpass: 2nd order Butterworth biquad, cut off where the boxcar is
+ *
+ * History is int16_t, written twice into a doubled ring so the newest
+ * `window` samples are always one contiguous run. Loops over it have no
+ * wraparound, and compilers can unroll or vectorize them.
+ *
+ * Per sample cost doesn't depend on the window, except for the (capped)
+ * median. Changing the window recomputes the boxcar from history, so there
+ * are no stale samples or jumps.
+ */
+class FilterBank {
+public:
+  FilterBank();
+
+  void addValue(long value);
+  void reset();
+
+  // Output of the selected stage, so this can stand in for a plain average.
+  long getAverage();
+  long get(FilterStage stage);
+
+  void setWindow(size_t window);
+  size_t getWindow() { return window; }
+  void setOutput(FilterStage stage) { output = stage; }
+  FilterStage getOutput() { return output; }
+
+  static const char *getStageName(FilterStage stage);
+  static bool findStage(const char *name, FilterStage &stage);
+
+private:
+  int16_t history[FILTER_HISTORY * 2] = {0};
+  size_t head = 0;
+  size_t filled = 0;
+  size_t window = 1;
+  FilterStage output = FilterBoxcar;
+
+  int32_t box_sum = 0;
+
+  // Q16.16
+  int32_t ema = 0;
+  int32_t ema_alpha = 0;
+
+  // Biquad, direct form I. Coefficients Q2.30, state Q16.16.
+  int32_t b0 = 0, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+  int32_t x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+
+  long outputs[FILTER_STAGES] = {0};
+
+  const int16_t *newest(size_t count);
+  void prime(int16_t value);
+  void updateCoefficients();
+  long median();
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef __FixedPoint_h
+#define __FixedPoint_h
+
+#include <stdint.h>
+
+/**
+ * Q16.16 signed fixed point, for the control loop. Gives +/-32767 with a
+ * resolution of 1/65536, which is plenty for pressure deltas and motor speeds,
+ * and keeps float math out of the per-sample path.
+ */
+typedef int32_t fixed_t;
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE   ((fixed_t)1 << FIXED_SHIFT)
+#define FIXED_MAX   INT32_MAX
+#define FIXED_MIN   INT32_MIN
+
+inline fixed_t int_to_fixed(long value) {
+  return (fixed_t)(value << FIXED_SHIFT);
+}
+
+inline fixed_t float_to_fixed(float value) {
+  return (fixed_t)(value * FIXED_ONE + (value >= 0 ? 0.5f : -0.5f));
+}
+
+/**
+ * Truncates toward negative infinity, like floor().
+ */
+inline long fixed_to_int(fixed_t value) {
+  return value >> FIXED_SHIFT;
+}
+
+/**
+ * Rounds to the nearest integer, half away from zero.
+ */
+inline long fixed_round(fixed_t value) {
+  return value >= 0
+      ? (value + (FIXED_ONE >> 1)) >> FIXED_SHIFT
+      : -((-value + (FIXED_ONE >> 1)) >> FIXED_SHIFT);
+}
+
+inline float fixed_to_float(fixed_t value) {
+  return (float)value / FIXED_ONE;
+}
+
+/**
+ * Rounded multiply, so repeated decay doesn't carry the truncation bias
+ * that a float-to-long conversion would.
+ */
+inline fixed_t fixed_mul(fixed_t a, fixed_t b) {
+  int64_t product = (int64_t)a * b;
+  return (fixed_t)((product + (1 << (FIXED_SHIFT - 1))) >> FIXED_SHIFT);
+}
+
+/**
+ * Saturating add. Clamps to FIXED_MIN / FIXED_MAX instead of wrapping.
+ */
+inline fixed_t fixed_add_sat(fixed_t a, fixed_t b) {
+  int64_t sum = (int64_t)a + b;
+  if (sum > FIXED_MAX) return FIXED_MAX;
+  if (sum < FIXED_MIN) return FIXED_MIN;
+  return (fixed_t)sum;
+}
+
+#endif
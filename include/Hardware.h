@@ -24,6 +24,10 @@ namespace Hardware {
   int getMotorSpeed();
   float getMotorSpeedPercent();
 
+  /**
+   * Reads the pressure sensor. While AdcCapture owns the ADC, this is the
+   * last captured reading instead.
+   */
   long getPressure();
   void setPressureSensitivity(byte value);
   /**
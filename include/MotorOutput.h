@@ -0,0 +1,62 @@
+#ifndef __MotorOutput_h
+#define __MotorOutput_h
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "../config.h"
+
+// The LEDC clock PWM resolution is carved out of.
+#define MOTOR_PWM_CLOCK_HZ 80000000
+
+// Duty resolution is as fine as the frequency allows, in this range. The
+// frequency is capped so it never drops below the minimum.
+#define MOTOR_PWM_MAX_BITS 12
+#define MOTOR_PWM_MIN_BITS 10
+
+// Slew timer rate, and so the time resolution of transitions.
+#define MOTOR_SLEW_HZ 1000
+
+// Segments in each transition profile table.
+#define MOTOR_PROFILE_SIZE 256
+
+enum MotorProfile {
+  MotorProfileLinear,
+  MotorProfileSCurve,
+  MotorProfileExponential,
+  MOTOR_PROFILES
+};
+
+/**
+ * Drives the motor through an LEDC channel, with 10 to 12 bits of duty, and
+ * eases every speed change instead of stepping it.
+ *
+ * A change moves from the current duty to the new one over motor_slew_ms per
+ * full scale, following the motor_profile curve. Curves are tabulated once
+ * (MOTOR_PROFILE_SIZE segments, Q16) when the config changes, and a
+ * MOTOR_SLEW_HZ esp_timer walks the table with integer interpolation, so
+ * there's no float math per step. A new speed mid-transition starts over
+ * from wherever the duty is. Stopping (speed 0) is never eased.
+ *
+ * The tables are kept out of this header so each includer doesn't get a copy.
+ */
+namespace MotorOutput {
+  bool begin();
+  void end();
+
+  // Picks up motor_pwm_hz, motor_slew_ms and motor_profile.
+  void configChanged();
+
+  // Target speed, 0-255
+  void setSpeed(byte speed);
+
+  // What the PWM is putting out right now, mid-transition or not.
+  uint32_t getDuty();
+  uint32_t getMaxDuty();
+
+  const char *getProfileName(MotorProfile profile);
+  bool findProfile(const char *name, MotorProfile &profile);
+
+  void printStatus(String &out);
+}
+
+#endif
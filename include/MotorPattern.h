@@ -0,0 +1,51 @@
+#ifndef __MotorPattern_h
+#define __MotorPattern_h
+
+#include <Arduino.h>
+
+// Steps in one pattern period.
+#define PATTERN_MAX_STEPS 32
+
+// Patterns loaded from PATTERN_DIR on the SD card, on top of the built-ins.
+#define PATTERN_MAX_LOADED 8
+#define PATTERN_DIR "/patterns"
+
+/**
+ * One period of a motor waveform, as levels 0-255 scaling the automatic
+ * ramp's speed. Steps are evenly spaced over period_ms, and either held
+ * (pulse-like) or linearly interpolated into the next (wave-like). The
+ * last step leads back into the first.
+ */
+typedef struct MotorPattern {
+  char name[16];
+  uint16_t period_ms;
+  uint8_t length;
+  bool interpolate;
+  uint8_t steps[PATTERN_MAX_STEPS];
+} MotorPattern;
+
+/**
+ * Built-in patterns, plus any loaded from the SD card as JSON:
+ *
+ *   {"name": "heartbeat", "period_ms": 1200, "interpolate": false,
+ *    "steps": [255, 64, 255, 64, 64, 64]}
+ *
+ * Evaluating a pattern is an index and an interpolation into its table, so
+ * any shape costs the same per tick.
+ */
+namespace MotorPatterns {
+  size_t count();
+  const MotorPattern *get(size_t index);
+  const MotorPattern *find(const char *name);
+
+  // Level 0-255 at `elapsed_ms` into the pattern.
+  uint8_t level(const MotorPattern &pattern, uint32_t elapsed_ms);
+
+  // Adds every *.json in PATTERN_DIR. Returns how many loaded.
+  int loadFromSd();
+
+  // Registers a pattern, replacing a loaded one with the same name.
+  bool add(const MotorPattern &pattern);
+}
+
+#endif
@@ -3,9 +3,31 @@
 
 #include <Arduino.h>
 #include "../config.h"
-#include "RunningAverage.h"
+#include "FilterBank.h"
+#include "BaselineTracker.h"
+#include "TrendPredictor.h"
+#include "MotorPattern.h"
+#include "FixedPoint.h"
+#include "Reading.h"
+#include "ArousalDetector.h"
+#include "Oversampler.h"
+#include "SampleBlock.h"
 #include <SD.h>
 
+// Arousal decays by this factor every tick at AROUSAL_DECAY_HZ, and at the
+// same rate per second at any other update frequency.
+#define AROUSAL_DECAY 0.99f
+#define AROUSAL_DECAY_HZ 50
+
+// Predictive edging fits the arousal trend over this much history...
+#define PREDICT_WINDOW_MS 1000
+// ...and only once arousal is at least this percent of the threshold, so
+// one quick rise from rest doesn't stop the motor.
+#define PREDICT_MIN_PERCENT 70
+
+// Recent control steps kept for batched streaming. Power of two.
+#define READING_HISTORY_SIZE 256
+
 namespace OrgasmControl {
   void tick();
 
@@ -16,8 +38,22 @@ namespace OrgasmControl {
   float getMotorSpeedPercent();
   long getLastPressure();
   long getAveragePressure();
+  long getBaseline();
   bool updated();
   int getDenialCount();
+  int getPredictedDenialCount();
+  const Reading &getReading();
+  uint32_t getReadingCount();
+  bool getHistoricReading(uint32_t index, Reading &out);
+  ArousalDetector *getDetector();
+  const MotorPattern *getPattern();
+
+  // Recalculate derived constants after motor_max_speed, motor_ramp_time_s
+  // or update_frequency_hz change, and pick up arousal_detector,
+  // pressure_smoothing, pressure_filter, baseline_window_s, edge_lead_ms
+  // and motor_pattern. Safe from any task: the change is applied at the
+  // start of the next tick().
+  void configChanged();
 
   // Set Controls
   void controlMotor(bool control = true);
@@ -34,24 +70,43 @@ namespace OrgasmControl {
 
     // Orgasmo Calculations
     // These can all probably be ints since we're really only using
-    // 11 bits of ADC wisdom.
-    RunningAverage PressureAverage;
-    long last_value = 4096;
+    // 11 bits of ADC wisdom. The filters, trend and reading history live in
+    // OrgasmControl.cpp, so each includer doesn't get a copy.
     long pressure_value = 0;
-    long peak_start = 0;
-    long arousal = 0;
-    float motor_speed = 0;
+    ArousalDetector *detector = nullptr;
+    const MotorPattern *pattern = nullptr;
+    long pattern_start_ms = 0;
+    fixed_t arousal = 0;
+    fixed_t motor_speed = 0;
     bool update_flag = false;
     bool control_motor = false;
     bool prev_control_motor = false;
     int denial_count = 0;
+    int predicted_denial_count = 0;
+
+    // DMA capture consumer, once subscribed
+    int capture_consumer = -1;
+
+    // Derived from Config in updateConstants()
+    fixed_t arousal_decay = FIXED_ONE;
+    fixed_t motor_increment = 0;
+    fixed_t motor_cooldown = 0;
+    fixed_t motor_max = 0;
+    long edge_lead_ticks = 0;
+    bool baseline_on = false;
 
-    // File Writer
-    long recording_start_ms = 0;
-    File logfile;
+    // Last control step, as recorded / streamed
+    Reading reading = {0};
+    uint32_t reading_count = 0;
 
-    void updateArousal();
+    void updateArousal(long pressure);
     void updateMotorSpeed();
+    bool edgePredicted();
+    void step(long pressure, long sample_ms);
+    void stepBlock(const SampleBlock *block);
+    void updateConstants();
+    void selectDetector();
+    void selectPattern();
   }
 }
 
@@ -0,0 +1,53 @@
+#ifndef __Oversampler_h
+#define __Oversampler_h
+
+#include <Arduino.h>
+
+// Most ADC reads taken for one reading.
+#define OVERSAMPLE_MAX 64
+
+// From this many samples on, the highest and lowest are dropped.
+#define OVERSAMPLE_TRIM_MIN 4
+
+/**
+ * Pressure ADC front-end. Instead of one analogRead() per control tick, it
+ * takes a burst of reads and decimates them into one reading: a first order
+ * CIC (integrate, then dump once per burst), with the single highest and
+ * lowest read trimmed off so ADC spikes can't become peaks.
+ *
+ * The result is rounded back to ADC counts, so thresholds keep their scale;
+ * the extra resolution shows up as a steadier signal.
+ */
+namespace Oversampler {
+  /**
+   * The decimator, fed one sample at a time. read() returns the decimated
+   * value of everything added since the last read().
+   */
+  class Decimator {
+  public:
+    void add(uint16_t sample) {
+      sum += sample;
+      lo = min(lo, sample);
+      hi = max(hi, sample);
+      n++;
+    }
+
+    size_t count() { return n; }
+    long read();
+
+  private:
+    uint32_t sum = 0;
+    uint16_t lo = UINT16_MAX;
+    uint16_t hi = 0;
+    size_t n = 0;
+  };
+
+  // Take `count` reads of `pin` and decimate them. A count of 0 or 1 is a
+  // plain analogRead().
+  long read(uint8_t pin, size_t count);
+
+  // The decimation step on its own, for reads taken elsewhere.
+  long decimate(const uint16_t *samples, size_t count);
+}
+
+#endif
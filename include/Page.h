@@ -5,6 +5,15 @@
 
 #define HISTORY_LENGTH 5
 
+typedef struct FrameStats {
+  uint32_t frames;
+  uint32_t invalidations;
+  uint32_t coalesced;
+  uint32_t last_render_us;
+  uint32_t max_render_us;
+  uint64_t total_render_us;
+} FrameStats;
+
 class Page {
 public:
   // Navigation
@@ -12,10 +21,16 @@ public:
   static void GoBack();
   static void DoLoop();
   static void Rerender();
+  static void RenderNow();
   static void Reenter();
   static void AttachButtonHandlers();
   static Page* CurrentPage();
 
+  // Frame Governor
+  static void GetFrameStats(FrameStats &stats);
+  static void ResetFrameStats();
+  static void PrintFrameStats(String &out);
+
   // Page Lifecycle
   virtual void Render();
   virtual void Loop();
@@ -33,6 +48,10 @@ private:
   static Page* previousPages[HISTORY_LENGTH];
   static size_t historyIndex;
 
+  static bool renderPending;
+  static long lastFrameMs;
+  static FrameStats frameStats;
+
   static void pushHistory(Page* page);
   static Page* popHistory();
 };
@@ -0,0 +1,50 @@
+#ifndef __PartialSSD1306_h
+#define __PartialSSD1306_h
+
+#include <Adafruit_SSD1306.h>
+
+/**
+ * SSD1306 driver which only transmits what changed.
+ *
+ * Keeps a shadow copy of what the panel is showing. display() compares the
+ * framebuffer against it one 8-row page at a time, and sends only the
+ * column range that differs on each dirty page. Redrawing an identical
+ * frame costs a memcmp instead of 1 KB over the bus.
+ *
+ * display() hides (doesn't override) the base class method, so hold this
+ * as a PartialSSD1306* for it to take effect.
+ *
+ * display(frame) sends a caller owned copy of the framebuffer instead, so
+ * a render task can transmit one frame while the next is being drawn.
+ */
+class PartialSSD1306 : public Adafruit_SSD1306 {
+public:
+  using Adafruit_SSD1306::Adafruit_SSD1306;
+  ~PartialSSD1306();
+
+  void display(void);
+  void display(const uint8_t *frame);
+
+  // Send the whole buffer, as Adafruit_SSD1306::display() does.
+  void displayFull(void);
+
+  // False for bit-banged SPI, which can only send its own buffer.
+  bool hasBus(void) { return wire != nullptr || spi != nullptr; }
+
+  // Forget what the panel shows, so the next display() sends everything.
+  void invalidate(void) { shadow_valid = false; }
+
+  // Bytes of pixel data sent by the last display(), and in total.
+  uint16_t getLastTransferSize(void) { return last_transfer_bytes; }
+  uint32_t getTotalTransferSize(void) { return total_transfer_bytes; }
+
+private:
+  uint8_t *shadow = nullptr;
+  bool shadow_valid = false;
+  uint16_t last_transfer_bytes = 0;
+  uint32_t total_transfer_bytes = 0;
+
+  void sendRange(uint8_t page, uint8_t first_col, uint8_t last_col, const uint8_t *data);
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef __Reading_h
+#define __Reading_h
+
+#include <stdint.h>
+
+/**
+ * One control step's worth of data, as recorded to SD and streamed to
+ * clients. Fixed size and packed, so 32 of them fill one 512 byte sector.
+ */
+typedef struct __attribute__((packed)) Reading {
+  uint32_t millis;
+  uint16_t pressure;
+  uint16_t avg_pressure;
+  uint16_t arousal;
+  uint8_t motor_speed;
+  uint8_t flags;
+  uint16_t sensitivity_threshold;
+  uint16_t baseline;
+} Reading;
+
+static_assert(sizeof(Reading) == 16, "Reading must stay 16 bytes; bump the recording format version if it changes");
+
+#endif
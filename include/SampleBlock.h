@@ -0,0 +1,82 @@
+#ifndef __SampleBlock_h
+#define __SampleBlock_h
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SAMPLE_BLOCK_SIZE 256
+
+/**
+ * A run of consecutive ADC samples, as captured by AdcCapture. Sample i was
+ * taken at timestamp_us + i * 1000000 / sample_rate_hz.
+ *
+ * Blocks live in a SampleBlockPool and are shared, not copied: every holder
+ * owns one reference and gives it back with release().
+ */
+typedef struct SampleBlock {
+  uint32_t sequence;
+  int64_t timestamp_us;
+  uint32_t sample_rate_hz;
+  uint16_t count;
+  uint16_t samples[SAMPLE_BLOCK_SIZE];
+
+  std::atomic<uint8_t> refs;
+
+  int64_t sampleTimeUs(size_t i) const {
+    return timestamp_us + (int64_t) i * 1000000 / sample_rate_hz;
+  }
+} SampleBlock;
+
+/**
+ * Fixed pool of reference counted SampleBlocks. acquire() and release() are
+ * lock-free and may be called from any task.
+ */
+template<size_t SIZE>
+class SampleBlockPool {
+public:
+  SampleBlockPool() {
+    for (size_t i = 0; i < SIZE; i++) {
+      blocks[i].refs.store(0);
+    }
+  }
+
+  /**
+   * Claims a free block, with one reference held by the caller.
+   * Returns nullptr if every block is still referenced.
+   */
+  SampleBlock *acquire() {
+    for (size_t i = 0; i < SIZE; i++) {
+      uint8_t expected = 0;
+      if (blocks[i].refs.compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+        return &blocks[i];
+      }
+    }
+
+    return nullptr;
+  }
+
+  static void retain(SampleBlock *block) {
+    block->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Drops one reference; the block goes back to the pool with the last one.
+   */
+  static void release(SampleBlock *block) {
+    block->refs.fetch_sub(1, std::memory_order_release);
+  }
+
+  size_t inUse() {
+    size_t count = 0;
+    for (size_t i = 0; i < SIZE; i++) {
+      if (blocks[i].refs.load(std::memory_order_relaxed) > 0) count++;
+    }
+    return count;
+  }
+
+private:
+  SampleBlock blocks[SIZE];
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef __SampleBuffer_h
+#define __SampleBuffer_h
+
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * Lock-free single-producer / single-consumer ring buffer.
+ *
+ * One task may push() and one (other) task may pop(), with no locking. Size
+ * must be a power of two; one slot is always left empty to tell full from
+ * empty, so the usable capacity is SIZE - 1.
+ */
+template<typename T, size_t SIZE>
+class SampleBuffer {
+  static_assert((SIZE & (SIZE - 1)) == 0, "SampleBuffer size must be a power of two");
+
+public:
+  /**
+   * Producer side. Returns false (and drops the value) if the buffer is full.
+   */
+  bool push(const T &value) {
+    size_t head = this->head.load(std::memory_order_relaxed);
+    size_t next = (head + 1) & (SIZE - 1);
+
+    if (next == this->tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    buffer[head] = value;
+    this->head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Consumer side. Returns false if there is nothing to read.
+   */
+  bool pop(T &value) {
+    size_t tail = this->tail.load(std::memory_order_relaxed);
+
+    if (tail == this->head.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    value = buffer[tail];
+    this->tail.store((tail + 1) & (SIZE - 1), std::memory_order_release);
+    return true;
+  }
+
+  size_t available() const {
+    return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) & (SIZE - 1);
+  }
+
+  /**
+   * Consumer side. Discards everything currently buffered.
+   */
+  void clear() {
+    tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+private:
+  T buffer[SIZE];
+  std::atomic<size_t> head{0};
+  std::atomic<size_t> tail{0};
+};
+
+#endif
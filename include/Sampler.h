@@ -0,0 +1,49 @@
+#ifndef __Sampler_h
+#define __Sampler_h
+
+#include <Arduino.h>
+
+#define SAMPLER_BUFFER_SIZE 128
+
+typedef struct PressureSample {
+  int64_t timestamp_us;
+  long pressure;
+} PressureSample;
+
+typedef struct SamplerStats {
+  uint32_t samples;
+  uint32_t dropped;
+  uint32_t period_us;
+  uint32_t min_interval_us;
+  uint32_t max_interval_us;
+  uint32_t max_jitter_us;
+  uint64_t total_jitter_us;
+} SamplerStats;
+
+/**
+ * Samples the pressure sensor on a fixed clock, independent of how long
+ * loop() takes. A hardware (esp_timer) alarm wakes a high priority task on
+ * core 0, which reads Hardware::getPressure() into a lock-free ring that
+ * OrgasmControl drains from the main loop.
+ *
+ * The timer, task and ring are kept out of this header so each includer
+ * doesn't get a copy.
+ */
+namespace Sampler {
+  bool begin(int frequency_hz);
+  void end();
+  bool running();
+  void setFrequency(int frequency_hz);
+  int getFrequency();
+
+  // Consumer side, called from the control loop only.
+  bool read(PressureSample &sample);
+  size_t available();
+
+  // Timing statistics, to prove the sample clock holds up under load.
+  void getStats(SamplerStats &stats);
+  void resetStats();
+  void printStats(String &out);
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef __SessionRecorder_h
+#define __SessionRecorder_h
+
+#include <Arduino.h>
+
+#include "Reading.h"
+
+#define RECORDER_MAGIC "EOMR"
+#define RECORDER_FORMAT_VERSION 2
+#define RECORDER_SECTOR_SIZE 512
+#define RECORDER_RECORDS_PER_SECTOR (RECORDER_SECTOR_SIZE / sizeof(Reading))
+
+/**
+ * File header. Padded out to a full sector on disk (header_size), so every
+ * record flush after it lands on a sector boundary.
+ */
+typedef struct __attribute__((packed)) RecordingHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t header_size;
+  uint16_t record_size;
+  uint16_t update_frequency_hz;
+  uint32_t start_millis;
+  char start_time[16];
+} RecordingHeader;
+
+/**
+ * Binary session recorder.
+ *
+ * The control loop appends fixed-size Readings into one half of a RAM
+ * double buffer. Whenever a half fills up, the background loop on core 0
+ * writes it out as one whole sector, so the control path never touches the
+ * SD card or the heap. Use bin/rec2csv.rb to convert recordings to CSV.
+ *
+ * The buffers and file are kept out of this header so each includer doesn't
+ * get a copy.
+ */
+namespace SessionRecorder {
+  bool start();
+
+  // Returns at once; the background loop closes the file.
+  void stop();
+  bool isRecording();
+  String getFilename();
+
+  // Control loop side:
+  void record(const Reading &reading);
+
+  // Background side:
+  void tick();
+
+  uint32_t getDroppedCount();
+}
+
+#endif
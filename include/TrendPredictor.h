@@ -0,0 +1,69 @@
+#ifndef __TrendPredictor_h
+#define __TrendPredictor_h
+
+#include "Arduino.h"
+#include "FixedPoint.h"
+
+// Points the ring holds. Longer windows average this many samples or more
+// into each point, so the window still spans its full length.
+#define TREND_MAX_POINTS 64
+
+/**
+ * Least squares line through the last `window` samples, to extrapolate a
+ * signal a short way ahead.
+ *
+ * Sliding the window only needs the sum of y and of x * y: every point
+ * already in the window moves down one x, which takes the old sum of y
+ * off the x * y sum. Both sums are exact integers, so the per-sample cost
+ * is O(1) at any window, with no drift over a long session.
+ *
+ * Past TREND_MAX_POINTS samples, each point is the mean of a block of
+ * samples; the fit then moves once per block, and is carried forward to
+ * the newest sample along its slope.
+ *
+ * Not thread safe: setWindow() and reset() move the ring's head and size,
+ * so they belong on the task that adds values.
+ */
+class TrendPredictor {
+public:
+  void addValue(fixed_t value);
+  void reset();
+
+  // Window length in samples, rounded down to whole blocks. Starts over.
+  void setWindow(size_t samples);
+  size_t getWindow() { return window * block_size; }
+
+  // Until the window first fills, there's no fit.
+  bool ready() { return filled >= window; }
+
+  // Per sample, Q16.16
+  fixed_t getSlope();
+
+  // The fitted line at the newest sample.
+  fixed_t getFitted();
+
+  /**
+   * Samples until the fitted line reaches `level`: 0 if it's already there,
+   * -1 if it never will (not rising, or no fit yet).
+   */
+  long samplesUntil(fixed_t level);
+
+private:
+  fixed_t history[TREND_MAX_POINTS] = {0};
+  size_t head = 0;
+  size_t filled = 0;
+
+  // In points, of block_size samples each.
+  size_t window = TREND_MAX_POINTS;
+  size_t block_size = 1;
+  size_t block_fill = 0;
+  int64_t block_sum = 0;
+
+  // x runs 0 (oldest) to window - 1 (newest).
+  int64_t sum_y = 0;
+  int64_t sum_xy = 0;
+
+  void addPoint(fixed_t value);
+};
+
+#endif
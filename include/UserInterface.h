@@ -27,6 +27,7 @@
 #include <functional>
 
 #include <Adafruit_SSD1306.h>
+#include "PartialSSD1306.h"
 
 typedef std::function<void(void)> ButtonCallback;
 typedef std::function<void(int)> RotaryCallback;
@@ -47,7 +48,7 @@ typedef struct {
 
 class UserInterface {
 public:
-  UserInterface(Adafruit_SSD1306* display);
+  UserInterface(PartialSSD1306* display);
   bool begin();
   void tick();
 
@@ -64,9 +65,12 @@ public:
   // Render Controls
   void fadeTo(byte color = SSD1306_BLACK, bool half = false);
   void clear(bool render = true);
-  void render();
+  void render(bool force = false);
+  void dim(bool dim);
   void displayOff() { display_on = false; }
   void displayOn() { display_on = true; }
+  uint32_t getSupersededFrames() { return frames_superseded; }
+  bool renderTaskRunning() { return render_task != nullptr; }
 
   // Icons
   void drawWifiIcon(byte strength = 255, long flash_ms = 0);
@@ -106,7 +110,7 @@ public:
   void screenshot(String &buffer);
   void screenshot(void);
 
-  Adafruit_SSD1306* display;
+  PartialSSD1306* display;
 
 private:
   bool display_on = true;
@@ -130,6 +134,23 @@ private:
 
   // Menu
   UIMenu *current_menu = nullptr;
+
+  // Render Task
+  // frames[0] is handed off by render(), frames[1] is owned by the task while
+  // it's on the bus. The task swaps them when it picks up a new frame.
+  TaskHandle_t render_task = nullptr;
+  SemaphoreHandle_t frame_lock = nullptr;
+  uint8_t *frames[2] = {nullptr, nullptr};
+  uint8_t *fade_frame = nullptr;
+  bool frame_pending = false;
+  bool frame_fade = false;
+  int8_t pending_dim = -1;
+  uint32_t frames_superseded = 0;
+
+  bool startRenderTask();
+  void queueFrame(bool fade);
+  void sendFade(const uint8_t *frame);
+  static void renderTask(void *param);
 };
 
 extern UserInterface UI;
@@ -7,11 +7,75 @@
 #define ARDUINOJSON_USE_LONG_LONG 1
 #include <ArduinoJson.h>
 
+#include "Reading.h"
+#include "../config.h"
+
+// Readings rate for clients which haven't asked for one.
+#define WS_DEFAULT_READINGS_HZ 15
+
+// Binary frame types, first byte of every WStype_BIN frame we send.
+#define WS_BIN_READINGS 0x01
+#define WS_BIN_READINGS_BATCH 0x02
+#define WS_BIN_SAMPLES 0x03
+
+// Largest batch a client can ask for. Must stay well under READING_HISTORY_SIZE.
+#define WS_MAX_READINGS_BATCH 64
+
+/**
+ * Binary readings frame: this header, then `count` packed Readings
+ * (little endian, see Reading.h).
+ */
+typedef struct __attribute__((packed)) ReadingsFrameHeader {
+  uint8_t type;
+  uint8_t count;
+} ReadingsFrameHeader;
+
+/**
+ * Batched readings frame: this header, then `count` consecutive Readings
+ * starting at control step `sequence`. A gap in sequence means readings
+ * were lost because the client fell behind.
+ */
+typedef struct __attribute__((packed)) ReadingsBatchHeader {
+  uint8_t type;
+  uint8_t count;
+  uint32_t sequence;
+} ReadingsBatchHeader;
+
+/**
+ * Raw pressure samples frame, straight from ADC capture: this header, then
+ * `count` uint16_t samples, the first one taken at timestamp_us.
+ */
+typedef struct __attribute__((packed)) SamplesFrameHeader {
+  uint8_t type;
+  uint8_t reserved;
+  uint16_t count;
+  uint32_t sequence;
+  uint32_t sample_rate_hz;
+  int64_t timestamp_us;
+} SamplesFrameHeader;
+
+enum ReadingsFormat {
+  ReadingsJson,
+  ReadingsBinary
+};
+
 typedef struct WebSocketConnection {
   int num;
   IPAddress ip;
   bool stream_readings = true;
   bool stream_screen_data = false;
+
+  // Readings subscription
+  ReadingsFormat readings_format = ReadingsJson;
+  long readings_period_ms = 1000 / WS_DEFAULT_READINGS_HZ;
+  long next_readings_ms = 0;
+
+  // Batched full-rate readings, if readings_batch > 0
+  uint8_t readings_batch = 0;
+  uint32_t next_reading_index = 0;
+
+  // Raw ADC capture blocks
+  bool stream_samples = false;
 } WebSocketConnection;
 
 namespace WebSocketHelper {
@@ -22,6 +86,7 @@ namespace WebSocketHelper {
   void send(const char *cmd, String text, int num = -1);
 
   void sendSettings(int num = -1);
+  void sendSettingsChanged(ConfigKeySet keys, int num = -1);
   void sendWxStatus(int num = -1);
   void sendSdStatus(int num = -1);
   void sendReadings(int num = -1);
@@ -33,7 +98,15 @@ namespace WebSocketHelper {
 
     std::map<int, WebSocketConnection*> connections;
 
+    // ADC capture consumer, subscribed by the first streamSamples
+    int capture_consumer = -1;
+
+    // Control steps already handed to sendReadings()
+    uint32_t streamed_reading_count = 0;
+
     void onMessage(int num, uint8_t * payload);
+    void sendReadingsBatches(WebSocketConnection *client);
+    void sendSamples();
 
     void onWebSocketEvent(int num,
                           WStype_t type,
@@ -3,19 +3,54 @@
 
 #include "Arduino.h"
 
-#define CONNECTION_TIMEOUT_S 5
+// An attempt that hasn't got an IP by now is dropped and retried.
+#define CONNECTION_TIMEOUT_S 10
 
+// Retry delay after a failed attempt or a dropped connection, doubling up to
+// the max until it connects again.
+#define WIFI_RETRY_MIN_MS 1000
+#define WIFI_RETRY_MAX_MS 60000
+
+// How often the signal strength is read while connected, and how far it has
+// to move (in dBm) before clients are told.
+#define WIFI_RSSI_INTERVAL_MS 2000
+#define WIFI_RSSI_REPORT_DB 5
+
+enum WiFiState {
+  WiFiOff,
+  WiFiConnecting,
+  WiFiConnected,
+  WiFiWaiting
+};
+
+/**
+ * The station connection, run off the WiFi event callbacks: begin() starts an
+ * attempt and returns, events move the state along, and tick() retries after
+ * a failure or a drop, with backoff, for as long as WiFi is on.
+ *
+ * Readers get the cached state and RSSI, never the radio, and clients get a
+ * wifiStatus message whenever either changes.
+ */
 namespace WiFiHelper {
   namespace {
     byte getWiFiStrength();
   }
 
+  // Starts connecting, if WiFi is on and configured. Doesn't wait for it.
   bool begin();
+
+  // Loop side: retries, samples the RSSI and reports changes.
+  void tick();
+
   bool connected();
   void disconnect();
+  WiFiState getState();
+  const char *getStateName(WiFiState state);
   String ip();
+  int rssi();
   String signalStrengthStr();
   void drawSignalIcon();
+  void printStatus(String &out);
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,33 @@
+#ifndef __sim_Sim_h
+#define __sim_Sim_h
+
+#include <Arduino.h>
+
+/**
+ * Host-side simulation environment. The simulator owns the clock and the
+ * pressure sensor; everything else the control code touches is stubbed out
+ * in SimHardware.cpp.
+ */
+namespace Sim {
+  void setTimeUs(unsigned long long us);
+  void advanceUs(unsigned long long us);
+  unsigned long now_ms();
+  unsigned long now_us();
+
+  // Sensor input, in raw ADC counts (0-4095)
+  void setPressure(long pressure);
+
+  // Synthetic ADC noise, added to every analogRead(): gaussian with the
+  // given standard deviation, plus full scale spikes on `spike_rate` of reads.
+  void setNoise(float sigma, float spike_rate = 0);
+
+  // The digipot setting the pressure was recorded at. Reads scale by the
+  // current Hardware::setPressureSensitivity() setting over this.
+  void setRecordedSensitivity(byte sensitivity);
+
+  // Set config to the firmware defaults, without touching the SD card.
+  void loadDefaultConfig();
+  bool setConfig(const char *key, const char *value);
+}
+
+#endif
@@ -0,0 +1,249 @@
+#include "Sim.h"
+
+#include "../config.h"
+#include "../include/Hardware.h"
+#include "../include/UserInterface.h"
+#include "../include/WiFiHelper.h"
+#include "../include/Sampler.h"
+#include "../include/AdcCapture.h"
+#include "../include/OrgasmControl.h"
+#include "../include/Oversampler.h"
+#include "../include/ConfigSchema.h"
+#include "../include/MotorOutput.h"
+
+#include <SD.h>
+#include <esp_timer.h>
+#include <random>
+#include <vector>
+
+HardwareSerial Serial;
+SDClass SD;
+ConfigStruct Config;
+UserInterface UI(nullptr);
+puType ESP32Encoder::useInternalWeakPullResistors = UP;
+
+struct esp_timer {
+  esp_timer_create_args_t args;
+  uint64_t period_us;
+  uint64_t next_us;
+  bool running;
+};
+
+namespace Sim {
+  namespace {
+    unsigned long long clock_us = 0;
+    long pressure = 0;
+
+    // Fixed seed, so noisy runs are repeatable.
+    std::mt19937 noise_rng(1);
+    float noise_sigma = 0;
+    float noise_spike_rate = 0;
+
+    byte recorded_sensitivity = 128;
+    byte sensitivity = 128;
+
+    std::vector<esp_timer*> timers;
+  }
+
+  void setTimeUs(unsigned long long us) {
+    clock_us = us;
+  }
+
+  void advanceUs(unsigned long long us) {
+    clock_us += us;
+
+    for (esp_timer *timer : timers) {
+      while (timer->running && timer->next_us <= clock_us) {
+        timer->next_us += timer->period_us;
+        timer->args.callback(timer->args.arg);
+      }
+    }
+  }
+
+  unsigned long now_ms() {
+    return clock_us / 1000;
+  }
+
+  unsigned long now_us() {
+    return clock_us;
+  }
+
+  void setPressure(long p) {
+    pressure = p;
+  }
+
+  void setNoise(float sigma, float spike_rate) {
+    noise_sigma = sigma;
+    noise_spike_rate = spike_rate;
+  }
+
+  void setRecordedSensitivity(byte value) {
+    recorded_sensitivity = max(value, (byte) 1);
+  }
+
+  void loadDefaultConfig() {
+    ConfigSchema::loadDefaults();
+    Hardware::setPressureSensitivity(Config.sensor_sensitivity);
+    MotorOutput::begin();
+    OrgasmControl::configChanged();
+  }
+
+  bool setConfig(const char *key, const char *value) {
+    const ConfigKey *option = ConfigSchema::find(key);
+    if (option == nullptr) {
+      return false;
+    }
+
+    ConfigSchema::parse(*option, value);
+    if (option->flags & CONFIG_SENSITIVITY) {
+      Hardware::setPressureSensitivity(Config.sensor_sensitivity);
+    }
+
+    if (option->flags & CONFIG_MOTOR) {
+      MotorOutput::configChanged();
+    }
+
+    OrgasmControl::configChanged();
+    return true;
+  }
+}
+
+int analogRead(uint8_t) {
+  long value = Sim::pressure * Sim::sensitivity / Sim::recorded_sensitivity;
+
+  if (Sim::noise_sigma > 0) {
+    std::normal_distribution<float> noise(0, Sim::noise_sigma);
+    value += lround(noise(Sim::noise_rng));
+  }
+
+  if (Sim::noise_spike_rate > 0) {
+    std::uniform_real_distribution<float> chance(0, 1);
+    if (chance(Sim::noise_rng) < Sim::noise_spike_rate) {
+      value = 4095;
+    }
+  }
+
+  return constrain(value, 0L, 4095L);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out) {
+  *out = new esp_timer { *args, 0, 0, false };
+  Sim::timers.push_back(*out);
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+  timer->period_us = max(period_us, (uint64_t) 1);
+  timer->next_us = Sim::clock_us + timer->period_us;
+  timer->running = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  timer->running = false;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  Sim::timers.erase(std::remove(Sim::timers.begin(), Sim::timers.end(), timer), Sim::timers.end());
+  delete timer;
+  return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+  return Sim::clock_us;
+}
+
+namespace Hardware {
+  void setMotorSpeed(int speed) {
+    motor_speed = min(max(speed, 0), 255);
+    MotorOutput::setSpeed(motor_speed);
+  }
+
+  int getMotorSpeed() {
+    return motor_speed;
+  }
+
+  float getMotorSpeedPercent() {
+    return (float)motor_speed / 255.0;
+  }
+
+  long getPressure() {
+    return Oversampler::read(BUTT_PIN, Config.pressure_oversampling);
+  }
+
+  void setPressureSensitivity(byte value) {
+    Sim::sensitivity = value;
+  }
+}
+
+/**
+ * The replay drives OrgasmControl::tick() on the simulated clock, so the
+ * background sampler never runs and the control loop falls back to polling.
+ */
+namespace Sampler {
+  bool running() {
+    return false;
+  }
+
+  int getFrequency() {
+    return 0;
+  }
+
+  void setFrequency(int) {
+    // noop
+  }
+
+  bool read(PressureSample &) {
+    return false;
+  }
+}
+
+namespace WiFiHelper {
+  bool connected() {
+    return false;
+  }
+}
+
+/**
+ * Nothing to save to; a replay never changes the config on disk.
+ */
+void saveConfigToSd(long) {
+  // noop
+}
+
+UserInterface::UserInterface(PartialSSD1306 *display) {
+  this->display = display;
+}
+
+void UserInterface::toast(const char *message, long, bool) {
+  Serial.print("[toast] ");
+  Serial.println(message);
+}
+
+void UserInterface::toastNow(const char *message, long duration, bool allow_clear) {
+  toast(message, duration, allow_clear);
+}
+
+void UserInterface::drawRecordIcon(byte, long) {
+  // noop
+}
+
+/**
+ * No I2S on the host; the replay feeds pressure through analogRead().
+ */
+namespace AdcCapture {
+  bool running() {
+    return false;
+  }
+
+  int subscribe(const char *) {
+    return -1;
+  }
+
+  bool receive(int, SampleBlock *&) {
+    return false;
+  }
+
+  void release(SampleBlock *) {}
+}
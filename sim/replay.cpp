@@ -0,0 +1,445 @@
+/**
+ * Replays a recorded session (.rec or .csv) through OrgasmControl on the host.
+ *
+ * The recording is treated as a zero-order-hold pressure signal: the
+ * simulator steps its clock in 1ms increments, serving the most recent
+ * recorded pressure to Hardware::getPressure(), and lets OrgasmControl::tick()
+ * decide when to update, exactly as it would on the device.
+ */
+
+#include "Sim.h"
+
+#include "../config.h"
+#include "../include/OrgasmControl.h"
+#include "../include/Hardware.h"
+#include "../include/SessionRecorder.h"
+#include "../include/AutoCalibration.h"
+#include "../include/MotorOutput.h"
+
+#include <chrono>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define CSV_HEADER "millis,pressure,avg_pressure,arousal,motor_speed,sensitivity_threshold"
+
+// A predicted denial not followed by a threshold crossing within this long
+// counts as a false alarm.
+#define FALSE_ALARM_MS 3000
+
+// Give the first tick room to fire, since last_update_ms starts at 0.
+#define START_OFFSET_MS 1000
+
+struct RunStats {
+  long ticks;
+  int denials;
+  int predicted_denials;
+  long peak_arousal;
+  double over_threshold_s;
+  double motor_on_s;
+  double arousal_rms_err;
+
+  // Reaction: how long before each threshold crossing the motor was
+  // stopped, and predictions that never crossed.
+  int crossings;
+  double mean_lead_ms;
+  int false_alarms;
+
+  // Longest from a denial to the PWM duty actually reaching 0.
+  long max_stop_ms;
+};
+
+struct Row {
+  long millis;
+  long pressure;
+  long avg_pressure;
+  long arousal;
+  long motor_speed;
+  long sensitivity_threshold;
+};
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+      "Usage: %s [-v] [-o out.csv | -c key=value] [-n sigma[,spikes]] [-g sensitivity] [-s key=value ...] <session.rec|session.csv>\n"
+      "\n"
+      "  -c key=value       Replay twice, as configured and with key=value, and compare\n"
+      "  -g sensitivity     The sensor_sensitivity the session was recorded at (default 128)\n"
+      "  -n sigma[,spikes]  Add gaussian ADC noise, and full scale spikes on a fraction of reads\n"
+      "  -o out.csv         Write the replayed session in the recording CSV format\n"
+      "  -r                 Record the replay with SessionRecorder, into the working directory\n"
+      "  -s key=value       Override a config value before replaying\n"
+      "  -v                 Show firmware serial output\n",
+      argv0);
+}
+
+/**
+ * Reads a binary recording, as written by SessionRecorder.
+ */
+static bool readRecording(FILE *f, const char *path, std::vector<Row> &rows) {
+  RecordingHeader header;
+
+  if (fread(&header, sizeof(header), 1, f) != 1 ||
+      header.version > RECORDER_FORMAT_VERSION ||
+      header.record_size < sizeof(Reading) ||
+      fseek(f, header.header_size, SEEK_SET) != 0) {
+    fprintf(stderr, "%s: unsupported recording\n", path);
+    return false;
+  }
+
+  uint8_t record[RECORDER_SECTOR_SIZE];
+  while (fread(record, header.record_size, 1, f) == 1) {
+    const Reading *reading = (const Reading*) record;
+
+    // Sectors are zero padded if a record doesn't fit the tail:
+    if (reading->millis == 0) continue;
+
+    Row r;
+    r.millis = reading->millis - header.start_millis;
+    r.pressure = reading->pressure;
+    r.avg_pressure = reading->avg_pressure;
+    r.arousal = reading->arousal;
+    r.motor_speed = reading->motor_speed;
+    r.sensitivity_threshold = reading->sensitivity_threshold;
+    rows.push_back(r);
+  }
+
+  return true;
+}
+
+static bool readSession(const char *path, std::vector<Row> &rows) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+
+  char line[256];
+  size_t magic_len = strlen(RECORDER_MAGIC);
+  if (fread(line, 1, magic_len, f) == magic_len && !strncmp(line, RECORDER_MAGIC, magic_len)) {
+    rewind(f);
+    bool ok = readRecording(f, path, rows);
+    fclose(f);
+    return ok;
+  }
+
+  rewind(f);
+  if (!fgets(line, sizeof(line), f) || strncmp(line, CSV_HEADER, strlen(CSV_HEADER))) {
+    fprintf(stderr, "%s: not a session recording (bad header)\n", path);
+    fclose(f);
+    return false;
+  }
+
+  while (fgets(line, sizeof(line), f)) {
+    Row r;
+    if (sscanf(line, "%ld,%ld,%ld,%ld,%ld,%ld",
+               &r.millis, &r.pressure, &r.avg_pressure, &r.arousal,
+               &r.motor_speed, &r.sensitivity_threshold) == 6) {
+      rows.push_back(r);
+    }
+  }
+
+  fclose(f);
+  return true;
+}
+
+/**
+ * Replays the session through OrgasmControl, in automatic mode, from the
+ * current config. Optionally writes each control step to `out`.
+ */
+static RunStats replay(const std::vector<Row> &rows, FILE *out) {
+  RunStats stats = {0};
+  double arousal_err_sq = 0;
+  double total_lead_ms = 0;
+  long prev_arousal = 0;
+  int prev_denials = 0;
+  int prev_predicted = 0;
+  long last_denial_ms = -1;
+  long pending_prediction_ms = -1;
+  long pending_stop_ms = -1;
+  double tick_s = 1.0 / max(Config.update_frequency_hz, 1);
+  unsigned long long t0_us = (unsigned long long) START_OFFSET_MS * 1000;
+
+  OrgasmControl::controlMotor(true);
+  Sim::setTimeUs(t0_us + (unsigned long long) rows[0].millis * 1000);
+
+  for (size_t i = 0; i < rows.size(); i++) {
+    const Row &r = rows[i];
+
+    // Hold this sample until the next one was taken:
+    long hold_until_ms = i + 1 < rows.size()
+        ? rows[i + 1].millis
+        : r.millis + 1000 / max(Config.update_frequency_hz, 1);
+
+    Sim::setPressure(r.pressure);
+
+    while (Sim::now_us() < t0_us + (unsigned long long) hold_until_ms * 1000) {
+      OrgasmControl::tick();
+
+      if (OrgasmControl::updated()) {
+        long arousal = OrgasmControl::getArousal();
+
+        stats.ticks++;
+        stats.peak_arousal = max(stats.peak_arousal, arousal);
+        if (arousal > Config.sensitivity_threshold) {
+          stats.over_threshold_s += tick_s;
+        }
+        if (Hardware::getMotorSpeed() > 0) {
+          stats.motor_on_s += tick_s;
+        }
+
+        long now_ms = Sim::now_ms();
+        if (OrgasmControl::getDenialCount() != prev_denials) {
+          prev_denials = OrgasmControl::getDenialCount();
+          last_denial_ms = now_ms;
+          pending_stop_ms = now_ms;
+        }
+        if (OrgasmControl::getPredictedDenialCount() != prev_predicted) {
+          prev_predicted = OrgasmControl::getPredictedDenialCount();
+          if (pending_prediction_ms < 0) {
+            pending_prediction_ms = now_ms;
+          }
+        }
+
+        if (arousal > Config.sensitivity_threshold && prev_arousal <= Config.sensitivity_threshold) {
+          stats.crossings++;
+          if (last_denial_ms >= 0) {
+            total_lead_ms += min(now_ms - last_denial_ms, (long) FALSE_ALARM_MS);
+          }
+          pending_prediction_ms = -1;
+        } else if (pending_prediction_ms >= 0 && now_ms - pending_prediction_ms > FALSE_ALARM_MS) {
+          stats.false_alarms++;
+          pending_prediction_ms = -1;
+        }
+        prev_arousal = arousal;
+
+        if (out) {
+          fprintf(out, "%lu,%ld,%ld,%ld,%d,%d,%ld\n",
+                  Sim::now_ms() - START_OFFSET_MS,
+                  OrgasmControl::getLastPressure(),
+                  OrgasmControl::getAveragePressure(),
+                  arousal,
+                  Hardware::getMotorSpeed(),
+                  Config.sensitivity_threshold,
+                  OrgasmControl::getBaseline());
+        }
+      }
+
+      if (pending_stop_ms >= 0 && MotorOutput::getDuty() == 0) {
+        stats.max_stop_ms = max(stats.max_stop_ms, (long) Sim::now_ms() - pending_stop_ms);
+        pending_stop_ms = -1;
+      }
+
+      // Stands in for the background loop:
+      SessionRecorder::tick();
+      Sim::advanceUs(1000);
+    }
+
+    double err = OrgasmControl::getArousal() - r.arousal;
+    arousal_err_sq += err * err;
+  }
+
+  stats.denials = OrgasmControl::getDenialCount();
+  stats.predicted_denials = OrgasmControl::getPredictedDenialCount();
+  stats.arousal_rms_err = sqrt(arousal_err_sq / rows.size());
+  stats.mean_lead_ms = stats.crossings > 0 ? total_lead_ms / stats.crossings : 0;
+  return stats;
+}
+
+/**
+ * Runs replay() in a child process, so each run starts from fresh firmware
+ * state, optionally with one config value overridden.
+ */
+static bool replayForked(const std::vector<Row> &rows, const char *key, const char *value, RunStats &stats) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    perror("pipe");
+    return false;
+  }
+
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    return false;
+  }
+
+  if (pid == 0) {
+    close(fds[0]);
+    if (key != nullptr && !Sim::setConfig(key, value)) {
+      fprintf(stderr, "Unknown config key: %s\n", key);
+      _exit(2);
+    }
+
+    RunStats child = replay(rows, nullptr);
+    bool sent = write(fds[1], &child, sizeof(child)) == sizeof(child);
+    _exit(sent ? 0 : 1);
+  }
+
+  close(fds[1]);
+  bool received = read(fds[0], &stats, sizeof(stats)) == sizeof(stats);
+  close(fds[0]);
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return received && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char **argv) {
+  const char *out_path = nullptr;
+  const char *in_path = nullptr;
+  bool verbose = false;
+  bool record = false;
+  const char *compare_key = nullptr;
+  const char *compare_value = nullptr;
+
+  Sim::loadDefaultConfig();
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      out_path = argv[++i];
+    } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+      char *kv = argv[++i];
+      char *eq = strchr(kv, '=');
+      if (eq == nullptr) {
+        usage(argv[0]);
+        return 2;
+      }
+      *eq = '\0';
+      if (!Sim::setConfig(kv, eq + 1)) {
+        fprintf(stderr, "Unknown config key: %s\n", kv);
+        return 2;
+      }
+    } else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+      char *kv = argv[++i];
+      char *eq = strchr(kv, '=');
+      if (eq == nullptr) {
+        usage(argv[0]);
+        return 2;
+      }
+      *eq = '\0';
+      compare_key = kv;
+      compare_value = eq + 1;
+    } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+      float sigma = 0, spikes = 0;
+      if (sscanf(argv[++i], "%f,%f", &sigma, &spikes) < 1) {
+        usage(argv[0]);
+        return 2;
+      }
+      Sim::setNoise(sigma, spikes);
+    } else if (!strcmp(argv[i], "-g") && i + 1 < argc) {
+      Sim::setRecordedSensitivity(atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "-r")) {
+      record = true;
+    } else if (!strcmp(argv[i], "-v")) {
+      verbose = true;
+    } else if (argv[i][0] == '-' || in_path != nullptr) {
+      usage(argv[0]);
+      return 2;
+    } else {
+      in_path = argv[i];
+    }
+  }
+
+  if (in_path == nullptr) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  std::vector<Row> rows;
+  if (!readSession(in_path, rows)) {
+    return 1;
+  }
+
+  if (rows.empty()) {
+    fprintf(stderr, "%s: no samples\n", in_path);
+    return 1;
+  }
+
+  if (compare_key != nullptr && (out_path != nullptr || record)) {
+    fprintf(stderr, "-c can't be combined with -o or -r\n");
+    return 2;
+  }
+
+  Serial.muted = !verbose;
+
+  if (compare_key != nullptr) {
+    RunStats runs[2];
+    for (int variant = 0; variant < 2; variant++) {
+      if (!replayForked(rows, variant ? compare_key : nullptr, compare_value, runs[variant])) {
+        fprintf(stderr, "Replay with %s failed\n", variant ? compare_key : "defaults");
+        return 1;
+      }
+    }
+
+    String label = String(compare_key) + "=" + compare_value;
+    printf("session:        %s\n", in_path);
+    printf("%-22s %14s %14s\n", "", "as configured", label.c_str());
+    printf("%-22s %14d %14d\n", "denials", runs[0].denials, runs[1].denials);
+    printf("%-22s %14d %14d\n", "  of which predicted", runs[0].predicted_denials, runs[1].predicted_denials);
+    printf("%-22s %14d %14d\n", "  false alarms", runs[0].false_alarms, runs[1].false_alarms);
+    printf("%-22s %14d %14d\n", "threshold crossings", runs[0].crossings, runs[1].crossings);
+    printf("%-22s %14.0f %14.0f\n", "  motor stopped (ms)", runs[0].mean_lead_ms, runs[1].mean_lead_ms);
+    printf("%-22s %14ld %14ld\n", "peak arousal", runs[0].peak_arousal, runs[1].peak_arousal);
+    printf("%-22s %14.1f %14.1f\n", "over threshold (s)", runs[0].over_threshold_s, runs[1].over_threshold_s);
+    printf("%-22s %14.1f %14.1f\n", "motor running (s)", runs[0].motor_on_s, runs[1].motor_on_s);
+    printf("%-22s %14ld %14ld\n", "slowest stop (ms)", runs[0].max_stop_ms, runs[1].max_stop_ms);
+    printf("%-22s %14.2f %14.2f\n", "arousal rms err", runs[0].arousal_rms_err, runs[1].arousal_rms_err);
+    return 0;
+  }
+
+  FILE *out = nullptr;
+  if (out_path != nullptr) {
+    out = fopen(out_path, "w");
+    if (!out) {
+      perror(out_path);
+      return 1;
+    }
+    fprintf(out, CSV_HEADER ",baseline\n");
+  }
+
+  if (record && !SessionRecorder::start()) {
+    fprintf(stderr, "Failed to start recording\n");
+    return 1;
+  }
+
+  auto wall_start = std::chrono::steady_clock::now();
+  RunStats stats = replay(rows, out);
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  double session_s = (rows.back().millis - rows.front().millis) / 1000.0;
+
+  if (out) {
+    fclose(out);
+  }
+
+  printf("session:        %s\n", in_path);
+  printf("samples:        %zu (%.1f s)\n", rows.size(), session_s);
+  printf("control ticks:  %ld\n", stats.ticks);
+  printf("denials:        %d (%d predicted)\n", stats.denials, stats.predicted_denials);
+  printf("peak arousal:   %ld (threshold %d)\n", stats.peak_arousal, Config.sensitivity_threshold);
+  printf("over threshold: %.1f s, motor running %.1f s\n", stats.over_threshold_s, stats.motor_on_s);
+  if (AutoCalibration::active()) {
+    String status;
+    AutoCalibration::printStatus(status);
+    printf("calibration:    %s", status.c_str());
+  }
+  printf("motor stop:     %ld ms at most after a denial\n", stats.max_stop_ms);
+  printf("arousal rms err: %.2f vs. recording\n", stats.arousal_rms_err);
+  printf("wall time:      %.3f s (%.0fx real-time)\n", wall_s, wall_s > 0 ? session_s / wall_s : 0.0);
+
+  // A denial has to cut the motor within the tick it happens on:
+  long tick_ms = 1000 / max(Config.update_frequency_hz, 1);
+  bool stopped_in_time = stats.max_stop_ms <= tick_ms;
+  if (!stopped_in_time) {
+    printf("FAIL: motor took longer than one %ld ms tick to stop\n", tick_ms);
+  }
+
+  if (record) {
+    SessionRecorder::stop();
+    // Stands in for the background loop, which does the close:
+    SessionRecorder::tick();
+    printf("recorded:       .%s (%u dropped)\n", SessionRecorder::getFilename().c_str(),
+           SessionRecorder::getDroppedCount());
+  }
+
+  return stopped_in_time ? 0 : 1;
+}
@@ -0,0 +1,20 @@
+#ifndef __sim_Adafruit_SSD1306_h
+#define __sim_Adafruit_SSD1306_h
+
+#include "Arduino.h"
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_SWITCHCAPVCC 0x02
+
+class Adafruit_SSD1306 {
+public:
+  Adafruit_SSD1306(int16_t, int16_t) {}
+
+protected:
+  // No bus on the host.
+  void *wire = nullptr;
+  void *spi = nullptr;
+};
+
+#endif
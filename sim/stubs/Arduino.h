@@ -0,0 +1,171 @@
+#ifndef __sim_Arduino_h
+#define __sim_Arduino_h
+
+/**
+ * Just enough of the ESP32 Arduino core to build the control code on a
+ * Linux host. Time is owned by the simulator, not the wall clock, so a
+ * replay can run as fast as the CPU allows.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+
+// FreeRTOS handles, which the ESP32 core pulls in with Arduino.h
+typedef void *TaskHandle_t;
+typedef void *SemaphoreHandle_t;
+
+// One thread on the host, so critical sections are no-ops.
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void) (mux))
+#define portEXIT_CRITICAL(mux) ((void) (mux))
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT  0x01
+#define OUTPUT 0x02
+#define HEX 16
+#define DEC 10
+#define F(s) (s)
+#define PI 3.1415926535897932384626433832795
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+namespace Sim {
+  unsigned long now_ms();
+  unsigned long now_us();
+}
+
+inline unsigned long millis() { return Sim::now_ms(); }
+inline unsigned long micros() { return Sim::now_us(); }
+inline void delay(unsigned long) {}
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+
+int analogRead(uint8_t pin);
+
+// LEDC PWM, as MotorOutput drives the motor. The duty is what's read back.
+inline double ledcSetup(uint8_t, double freq, uint8_t) { return freq; }
+inline void ledcAttachPin(uint8_t, uint8_t) {}
+inline void ledcWrite(uint8_t, uint32_t) {}
+
+inline long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+// newlib has strlcpy, older glibc doesn't.
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+inline size_t strlcpy(char *dst, const char *src, size_t size) {
+  size_t len = strlen(src);
+  if (size > 0) {
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+#endif
+
+inline bool getLocalTime(struct tm *, uint32_t = 5000) {
+  return false;
+}
+
+class String {
+public:
+  String(const char *s = "") : str(s ? s : "") {}
+  String(const std::string &s) : str(s) {}
+  String(char c) : str(1, c) {}
+  String(int v, unsigned char base = 10) { fromLong(v, base); }
+  String(unsigned int v, unsigned char base = 10) { fromLong(v, base); }
+  String(long v, unsigned char base = 10) { fromLong(v, base); }
+  String(unsigned long v, unsigned char base = 10) { fromLong(v, base); }
+  String(unsigned char v, unsigned char base = 10) { fromLong(v, base); }
+  String(float v, unsigned char decimals = 2) { fromDouble(v, decimals); }
+  String(double v, unsigned char decimals = 2) { fromDouble(v, decimals); }
+
+  const char *c_str() const { return str.c_str(); }
+  unsigned int length() const { return str.length(); }
+  char operator[](unsigned int i) const { return str[i]; }
+  bool operator==(const String &o) const { return str == o.str; }
+  bool operator!=(const String &o) const { return str != o.str; }
+
+  String &operator+=(const String &o) { str += o.str; return *this; }
+  String &operator+=(const char *o) { str += o; return *this; }
+  String &operator+=(char c) { str += c; return *this; }
+  String &operator+=(int v) { return *this += String(v); }
+  String &operator+=(long v) { return *this += String(v); }
+  String &operator+=(unsigned long v) { return *this += String(v); }
+  String &operator+=(unsigned char v) { return *this += String(v); }
+
+  friend String operator+(const String &a, const String &b) { return String(a.str + b.str); }
+  friend String operator+(const String &a, const char *b) { return String(a.str + b); }
+  friend String operator+(const char *a, const String &b) { return String(a + b.str); }
+  friend String operator+(const String &a, char b) { return String(a.str + b); }
+
+  int lastIndexOf(char c) const {
+    size_t i = str.rfind(c);
+    return i == std::string::npos ? -1 : (int) i;
+  }
+
+  String substring(unsigned int from, unsigned int to) const {
+    return String(str.substr(from, to - from));
+  }
+
+private:
+  std::string str;
+
+  void fromLong(long v, unsigned char base) {
+    char buf[34];
+    if (base == 16) snprintf(buf, sizeof(buf), "%lx", v);
+    else snprintf(buf, sizeof(buf), "%ld", v);
+    str = buf;
+  }
+
+  void fromDouble(double v, unsigned char decimals) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+    str = buf;
+  }
+};
+
+class HardwareSerial {
+public:
+  void begin(unsigned long) {}
+  int available() { return 0; }
+  int read() { return -1; }
+
+  template<typename T> void print(const T &v) { write(String(v)); }
+  template<typename T> void println(const T &v) { write(String(v)); write("\n"); }
+  void println() { write("\n"); }
+
+  template<typename... Args> void printf(const char *fmt, Args... args) {
+    if (muted) return;
+    fprintf(stderr, fmt, args...);
+  }
+
+  /**
+   * Replays print a lot of chatter through here; mute it for benchmarks.
+   */
+  bool muted = false;
+
+private:
+  void write(const String &s) {
+    if (!muted) fputs(s.c_str(), stderr);
+  }
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef __sim_ArduinoJson_h
+#define __sim_ArduinoJson_h
+
+// The simulator never serializes config; the firmware headers only need the name.
+class JsonDocument {};
+
+#endif
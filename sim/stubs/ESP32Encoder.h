@@ -0,0 +1,19 @@
+#ifndef __sim_ESP32Encoder_h
+#define __sim_ESP32Encoder_h
+
+#include <stdint.h>
+
+enum puType { UP, DOWN, NONE };
+
+class ESP32Encoder {
+public:
+  static puType useInternalWeakPullResistors;
+  void attachSingleEdge(int, int) {}
+  int32_t getCount() { return count; }
+  void setCount(int32_t c) { count = c; }
+
+private:
+  int32_t count = 0;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef __sim_FS_h
+#define __sim_FS_h
+
+#include "Arduino.h"
+
+#define FILE_READ   "rb"
+#define FILE_WRITE  "wb"
+#define FILE_APPEND "ab"
+
+class File {
+public:
+  File(FILE *f = nullptr) : f(f) {}
+
+  operator bool() const { return f != nullptr; }
+
+  size_t write(const uint8_t *buf, size_t size) {
+    return f ? fwrite(buf, 1, size, f) : 0;
+  }
+
+  size_t read(uint8_t *buf, size_t size) {
+    return f ? fread(buf, 1, size, f) : 0;
+  }
+
+  int read() {
+    return f ? fgetc(f) : -1;
+  }
+
+  int available() {
+    if (!f) return 0;
+    int c = fgetc(f);
+    if (c == EOF) return 0;
+    ungetc(c, f);
+    return 1;
+  }
+
+  void print(const String &s) {
+    if (f) fputs(s.c_str(), f);
+  }
+
+  void println(const String &s) {
+    print(s);
+    print("\n");
+  }
+
+  void flush() {
+    if (f) fflush(f);
+  }
+
+  void close() {
+    if (f) fclose(f);
+    f = nullptr;
+  }
+
+private:
+  FILE *f;
+};
+
+#endif
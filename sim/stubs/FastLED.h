@@ -0,0 +1,22 @@
+#ifndef __sim_FastLED_h
+#define __sim_FastLED_h
+
+#include "Arduino.h"
+
+struct CRGB {
+  enum { Black = 0x000000, Green = 0x008000 };
+
+  uint8_t r = 0, g = 0, b = 0;
+
+  CRGB() {}
+  CRGB(uint32_t color) : r((color >> 16) & 0xFF), g((color >> 8) & 0xFF), b(color & 0xFF) {}
+  CRGB(uint8_t r, uint8_t g, uint8_t b) : r(r), g(g), b(b) {}
+};
+
+struct CHSV {
+  uint8_t h, s, v;
+  CHSV(uint8_t h, uint8_t s, uint8_t v) : h(h), s(s), v(v) {}
+  operator CRGB() const { return CRGB(v, v, v); }
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef __sim_OneButton_h
+#define __sim_OneButton_h
+
+typedef void (*callbackFunction)(void);
+
+class OneButton {
+public:
+  OneButton(int, bool = true, bool = true) {}
+  void tick() {}
+  void attachClick(callbackFunction) {}
+  void attachPress(callbackFunction) {}
+};
+
+#endif
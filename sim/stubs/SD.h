@@ -0,0 +1,39 @@
+#ifndef __sim_SD_h
+#define __sim_SD_h
+
+#include "FS.h"
+
+/**
+ * Maps the SD card onto a host directory (the working directory by default).
+ */
+class SDClass {
+public:
+  File open(const String &path, const char *mode = FILE_READ) {
+    return File(fopen(resolve(path).c_str(), mode));
+  }
+
+  bool exists(const String &path) {
+    FILE *f = fopen(resolve(path).c_str(), "rb");
+    if (f) fclose(f);
+    return f != nullptr;
+  }
+
+  bool remove(const String &path) {
+    return ::remove(resolve(path).c_str()) == 0;
+  }
+
+  bool rename(const String &from, const String &to) {
+    return ::rename(resolve(from).c_str(), resolve(to).c_str()) == 0;
+  }
+
+  String root = ".";
+
+private:
+  String resolve(const String &path) {
+    return root + path;
+  }
+};
+
+extern SDClass SD;
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef __sim_analogWrite_h
+#define __sim_analogWrite_h
+
+#include <stdint.h>
+
+inline void analogWrite(uint8_t, int) {}
+
+#endif
@@ -0,0 +1,2 @@
+// Case-insensitive filesystems let the firmware include "arduino.h"; Linux doesn't.
+#include "Arduino.h"
@@ -0,0 +1,34 @@
+#ifndef __sim_esp_timer_h
+#define __sim_esp_timer_h
+
+#include <stdint.h>
+
+/**
+ * Periodic timers on the simulated clock: SimHardware.cpp fires whatever is
+ * due each time the clock advances.
+ */
+typedef struct esp_timer *esp_timer_handle_t;
+typedef int esp_err_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef enum {
+  ESP_TIMER_TASK
+} esp_timer_dispatch_t;
+
+typedef struct {
+  esp_timer_cb_t callback;
+  void *arg;
+  esp_timer_dispatch_t dispatch_method;
+  const char *name;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+int64_t esp_timer_get_time();
+
+#endif
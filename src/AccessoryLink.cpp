@@ -0,0 +1,530 @@
+#include "../include/AccessoryLink.h"
+
+#include <WireSlave.h>
+#include <esp_timer.h>
+
+// What an accessory hasn't been sent yet.
+#define DIRTY_SPEED 0x01
+#define DIRTY_READINGS 0x02
+#define DIRTY_ALL (DIRTY_SPEED | DIRTY_READINGS)
+
+// Error code past what Wire.endTransmission() returns.
+#define LINK_ERROR_BUS_BUSY 0xFE
+
+static const char *state_names[] = {
+  "idle",
+  "ok",
+  "retrying",
+  "down"
+};
+
+namespace AccessoryLink {
+  namespace {
+    typedef struct Device {
+      Accessory info;
+      uint8_t dirty;
+      uint32_t retry_ms;
+      uint32_t retry_at;
+    } Device;
+
+    typedef struct Scale {
+      uint8_t address;
+      uint8_t percent;
+    } Scale;
+
+    TaskHandle_t task = nullptr;
+    SemaphoreHandle_t bus_mutex = nullptr;
+    volatile bool stopping = false;
+    volatile bool active = false;
+    volatile bool scan_requested = false;
+
+    // Guards everything below, between the loop and the link task.
+    portMUX_TYPE link_mux = portMUX_INITIALIZER_UNLOCKED;
+    Device devices[ACCESSORY_MAX_DEVICES];
+    size_t device_count = 0;
+    Scale scales[ACCESSORY_MAX_DEVICES];
+    size_t scale_count = 0;
+    uint8_t speed = 0;
+    uint16_t pressure = 0;
+    uint16_t arousal = 0;
+    AccessoryLinkStats stats = {0};
+
+    uint8_t scaleFor(uint8_t address) {
+      for (size_t i = 0; i < scale_count; i++) {
+        if (scales[i].address == address) {
+          return scales[i].percent;
+        }
+      }
+
+      return 100;
+    }
+
+    void resetDevice(Device &device, uint8_t address) {
+      memset(&device, 0, sizeof(Device));
+      device.info.address = address;
+      device.info.scale = scaleFor(address);
+      device.dirty = DIRTY_ALL;
+    }
+
+    // Under link_mux.
+    void markAll(uint8_t what) {
+      bool pending = false;
+
+      for (size_t i = 0; i < device_count; i++) {
+        pending |= (devices[i].dirty & what) != 0;
+        devices[i].dirty |= what;
+      }
+
+      stats.queued++;
+      if (pending) {
+        stats.coalesced++;
+      }
+    }
+
+    bool due(const Device &device, uint32_t now) {
+      return device.dirty != 0 && (device.retry_ms == 0 || (int32_t) (now - device.retry_at) >= 0);
+    }
+
+    /**
+     * One frame to one accessory, with everything it's missing. The caller
+     * holds the bus.
+     */
+    uint8_t transmit(const Device &device, uint8_t level, uint16_t p, uint16_t a) {
+      WirePacker packer;
+
+      if (device.dirty & DIRTY_SPEED) {
+        packer.write(ACCESSORY_OP_MOTOR_SPEED);
+        packer.write(level);
+      }
+
+      if (device.dirty & DIRTY_READINGS) {
+        packer.write(ACCESSORY_OP_READINGS);
+        packer.write(p >> 8);
+        packer.write(p & 0xFF);
+        packer.write(a >> 8);
+        packer.write(a & 0xFF);
+      }
+
+      packer.end();
+
+      Wire.beginTransmission(device.info.address);
+      while (packer.available()) {
+        Wire.write(packer.read());
+      }
+      return Wire.endTransmission();
+    }
+
+    /**
+     * Probes the scan range with empty writes, releasing the bus between
+     * probes so the digipot never waits long. Accessories that were already
+     * known keep their stats.
+     */
+    void enumerate() {
+      uint8_t found[ACCESSORY_MAX_DEVICES];
+      size_t count = 0;
+
+      for (uint8_t addr = ACCESSORY_SCAN_FIRST; addr <= ACCESSORY_SCAN_LAST && count < ACCESSORY_MAX_DEVICES; addr++) {
+        if (addr == ACCESSORY_DIGIPOT_ADDR || stopping) {
+          continue;
+        }
+
+        if (!takeBus(ACCESSORY_RETRY_MAX_MS)) {
+          continue;
+        }
+
+        Wire.beginTransmission(addr);
+        uint8_t err = Wire.endTransmission();
+        giveBus();
+
+        if (err == 0) {
+          found[count++] = addr;
+        }
+      }
+
+      // Nothing answered, so keep trying where an accessory usually is:
+      bool any = count > 0;
+      if (!any) {
+        found[count++] = ACCESSORY_DEFAULT_ADDR;
+      }
+
+      portENTER_CRITICAL(&link_mux);
+      Device next[ACCESSORY_MAX_DEVICES];
+      for (size_t i = 0; i < count; i++) {
+        resetDevice(next[i], found[i]);
+        for (size_t j = 0; j < device_count; j++) {
+          if (devices[j].info.address == found[i]) {
+            next[i] = devices[j];
+            next[i].dirty = DIRTY_ALL;
+            break;
+          }
+        }
+      }
+
+      memcpy(devices, next, sizeof(Device) * count);
+      device_count = count;
+      stats.scans++;
+      portEXIT_CRITICAL(&link_mux);
+
+      Serial.println("Found " + String(any ? count : 0) + " accessories.");
+    }
+
+    /**
+     * Everything due goes out in one go: the bus is taken once, and each
+     * accessory gets one frame with its own speed.
+     */
+    void burst() {
+      Device work[ACCESSORY_MAX_DEVICES];
+      uint8_t errors[ACCESSORY_MAX_DEVICES];
+      uint32_t now = millis();
+      size_t count;
+      uint8_t s;
+      uint16_t p, a;
+      bool any = false;
+
+      portENTER_CRITICAL(&link_mux);
+      count = device_count;
+      for (size_t i = 0; i < count; i++) {
+        work[i] = devices[i];
+        if (due(devices[i], now)) {
+          devices[i].dirty = 0;
+          any = true;
+        } else {
+          work[i].dirty = 0;
+        }
+      }
+      s = speed;
+      p = pressure;
+      a = arousal;
+      portEXIT_CRITICAL(&link_mux);
+
+      if (!any) {
+        return;
+      }
+
+      int64_t start_us = esp_timer_get_time();
+      bool locked = takeBus(ACCESSORY_RETRY_MAX_MS);
+
+      for (size_t i = 0; i < count; i++) {
+        if (work[i].dirty == 0) {
+          continue;
+        }
+
+        uint8_t level = min((uint32_t) s * work[i].info.scale / 100, (uint32_t) 255);
+        errors[i] = locked ? transmit(work[i], level, p, a) : LINK_ERROR_BUS_BUSY;
+      }
+
+      if (locked) {
+        giveBus();
+      }
+
+      uint32_t burst_us = esp_timer_get_time() - start_us;
+      now = millis();
+
+      // Only this task changes the device list, so the indexes still hold.
+      portENTER_CRITICAL(&link_mux);
+      stats.bursts++;
+      stats.last_burst_us = burst_us;
+      stats.max_burst_us = max(stats.max_burst_us, burst_us);
+
+      for (size_t i = 0; i < count; i++) {
+        if (work[i].dirty == 0) {
+          continue;
+        }
+
+        Device &device = devices[i];
+        device.info.last_error = errors[i];
+
+        if (errors[i] == 0) {
+          device.info.sent++;
+          device.info.consecutive_failures = 0;
+          device.info.last_ok_ms = now;
+          device.retry_ms = 0;
+        } else {
+          device.info.failed++;
+          device.info.consecutive_failures++;
+          device.dirty |= work[i].dirty;
+          device.retry_ms = device.retry_ms == 0 ? ACCESSORY_RETRY_MIN_MS :
+                            min(device.retry_ms * 2, (uint32_t) ACCESSORY_RETRY_MAX_MS);
+          device.retry_at = now + device.retry_ms;
+        }
+      }
+      portEXIT_CRITICAL(&link_mux);
+    }
+
+    // Until the next accessory with something waiting is due.
+    TickType_t nextWait() {
+      uint32_t now = millis();
+      int32_t soonest = INT32_MAX;
+
+      portENTER_CRITICAL(&link_mux);
+      for (size_t i = 0; i < device_count; i++) {
+        if (devices[i].dirty == 0) {
+          continue;
+        }
+
+        int32_t wait = devices[i].retry_ms == 0 ? 0 : (int32_t) (devices[i].retry_at - now);
+        soonest = min(soonest, max(wait, (int32_t) 0));
+      }
+      portEXIT_CRITICAL(&link_mux);
+
+      return soonest == INT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(soonest);
+    }
+
+    void linkTask(void*) {
+      uint32_t next_burst_at = 0;
+      TickType_t wait = portMAX_DELAY;
+
+      while (!stopping) {
+        ulTaskNotifyTake(pdTRUE, wait);
+        if (stopping) {
+          break;
+        }
+
+        if (scan_requested) {
+          scan_requested = false;
+          if (active) {
+            enumerate();
+          }
+        }
+
+        int32_t gap = (int32_t) (next_burst_at - millis());
+        if (gap > 0) {
+          wait = pdMS_TO_TICKS(gap);
+          continue;
+        }
+
+        if (active) {
+          burst();
+          next_burst_at = millis() + ACCESSORY_BURST_INTERVAL_MS;
+        }
+
+        wait = nextWait();
+      }
+
+      task = nullptr;
+      vTaskDelete(NULL);
+    }
+  }
+
+  bool begin() {
+    if (bus_mutex == nullptr) {
+      bus_mutex = xSemaphoreCreateMutex();
+    }
+
+    if (task != nullptr) {
+      return true;
+    }
+
+    configChanged();
+
+    portENTER_CRITICAL(&link_mux);
+    if (device_count == 0) {
+      resetDevice(devices[0], ACCESSORY_DEFAULT_ADDR);
+      device_count = 1;
+    }
+    portEXIT_CRITICAL(&link_mux);
+
+    stopping = false;
+
+    // Below the sampler, so a stuck bus never holds up a pressure reading.
+    if (xTaskCreatePinnedToCore(linkTask, "accessoryLink", 3072, NULL,
+                                1, &task, 0) != pdPASS) {
+      Serial.println("Failed to start accessory link task!");
+      task = nullptr;
+      return false;
+    }
+
+    return true;
+  }
+
+  void end() {
+    if (task == nullptr) {
+      return;
+    }
+
+    // The task notices between bursts.
+    stopping = true;
+    xTaskNotifyGive(task);
+    for (int i = 0; i < 100 && task != nullptr; i++) {
+      delay(5);
+    }
+  }
+
+  void setActive(bool on) {
+    if (on == active) {
+      return;
+    }
+
+    portENTER_CRITICAL(&link_mux);
+    for (size_t i = 0; i < device_count; i++) {
+      devices[i].dirty = on ? DIRTY_ALL : 0;
+      devices[i].retry_ms = 0;
+      devices[i].info.consecutive_failures = 0;
+    }
+    active = on;
+    portEXIT_CRITICAL(&link_mux);
+
+    if (on) {
+      scan();
+    }
+  }
+
+  bool isActive() {
+    return active;
+  }
+
+  void sendSpeed(byte value) {
+    portENTER_CRITICAL(&link_mux);
+    speed = value;
+    if (active) {
+      markAll(DIRTY_SPEED);
+    }
+    portEXIT_CRITICAL(&link_mux);
+
+    if (active && task != nullptr) {
+      xTaskNotifyGive(task);
+    }
+  }
+
+  void sendReadings(long p, long a) {
+    portENTER_CRITICAL(&link_mux);
+    pressure = constrain(p, 0L, (long) UINT16_MAX);
+    arousal = constrain(a, 0L, (long) UINT16_MAX);
+    if (active) {
+      markAll(DIRTY_READINGS);
+    }
+    portEXIT_CRITICAL(&link_mux);
+
+    if (active && task != nullptr) {
+      xTaskNotifyGive(task);
+    }
+  }
+
+  void scan() {
+    scan_requested = true;
+    if (task != nullptr) {
+      xTaskNotifyGive(task);
+    }
+  }
+
+  void configChanged() {
+    Scale parsed[ACCESSORY_MAX_DEVICES];
+    size_t count = 0;
+    char buf[sizeof(Config.accessory_scale)];
+    char *save = nullptr;
+
+    strlcpy(buf, Config.accessory_scale, sizeof(buf));
+
+    for (char *pair = strtok_r(buf, ", ", &save); pair != nullptr && count < ACCESSORY_MAX_DEVICES;
+         pair = strtok_r(nullptr, ", ", &save)) {
+      char *end = nullptr;
+      long address = strtol(pair, &end, 0);
+
+      if (end == pair || *end != ':' || address < ACCESSORY_SCAN_FIRST || address > ACCESSORY_SCAN_LAST) {
+        Serial.println("Invalid accessory scale: " + String(pair));
+        continue;
+      }
+
+      parsed[count].address = address;
+      parsed[count].percent = constrain(atoi(end + 1), 0, 200);
+      count++;
+    }
+
+    portENTER_CRITICAL(&link_mux);
+    memcpy(scales, parsed, sizeof(Scale) * count);
+    scale_count = count;
+    for (size_t i = 0; i < device_count; i++) {
+      devices[i].info.scale = scaleFor(devices[i].info.address);
+      devices[i].dirty |= active ? DIRTY_SPEED : 0;
+    }
+    portEXIT_CRITICAL(&link_mux);
+
+    if (active && task != nullptr) {
+      xTaskNotifyGive(task);
+    }
+  }
+
+  bool takeBus(uint32_t wait_ms) {
+    if (bus_mutex == nullptr) {
+      return true;
+    }
+
+    return xSemaphoreTake(bus_mutex, pdMS_TO_TICKS(wait_ms)) == pdTRUE;
+  }
+
+  void giveBus() {
+    if (bus_mutex != nullptr) {
+      xSemaphoreGive(bus_mutex);
+    }
+  }
+
+  size_t getDeviceCount() {
+    return device_count;
+  }
+
+  bool getDevice(size_t index, Accessory &device) {
+    bool found = false;
+
+    portENTER_CRITICAL(&link_mux);
+    if (index < device_count) {
+      device = devices[index].info;
+      found = true;
+    }
+    portEXIT_CRITICAL(&link_mux);
+
+    return found;
+  }
+
+  AccessoryLinkState getState(const Accessory &device) {
+    if (device.sent == 0 && device.failed == 0) {
+      return AccessoryLinkIdle;
+    } else if (device.consecutive_failures == 0) {
+      return AccessoryLinkOk;
+    } else if (device.consecutive_failures < ACCESSORY_DOWN_AFTER) {
+      return AccessoryLinkRetrying;
+    } else {
+      return AccessoryLinkDown;
+    }
+  }
+
+  const char *getStateName(AccessoryLinkState state) {
+    return state <= AccessoryLinkDown ? state_names[state] : "";
+  }
+
+  void getStats(AccessoryLinkStats &out) {
+    portENTER_CRITICAL(&link_mux);
+    out = stats;
+    portEXIT_CRITICAL(&link_mux);
+  }
+
+  void resetStats() {
+    portENTER_CRITICAL(&link_mux);
+    stats = AccessoryLinkStats();
+    for (size_t i = 0; i < device_count; i++) {
+      Accessory &info = devices[i].info;
+      info.sent = info.failed = info.consecutive_failures = 0;
+      info.last_error = 0;
+      info.last_ok_ms = 0;
+    }
+    portEXIT_CRITICAL(&link_mux);
+  }
+
+  void printStats(String &out) {
+    AccessoryLinkStats s;
+    getStats(s);
+
+    out += "Link: " + String(active ? "active" : "inactive") + ", " + String(s.scans) + " scans\n";
+    out += "Queued: " + String(s.queued) + " (" + String(s.coalesced) + " coalesced)\n";
+    out += "Bursts: " + String(s.bursts) + ", last " + String(s.last_burst_us) +
+           " us, max " + String(s.max_burst_us) + " us\n";
+
+    Accessory device;
+    for (size_t i = 0; getDevice(i, device); i++) {
+      out += "0x" + String(device.address, HEX) + ": " + String(getStateName(getState(device))) +
+             ", " + String(device.scale) + "%, sent " + String(device.sent) +
+             ", failed " + String(device.failed) + " (" + String(device.consecutive_failures) +
+             " in a row), last error " + String(device.last_error) + ", last ok " +
+             (device.last_ok_ms > 0 ? String(millis() - device.last_ok_ms) + " ms ago" : String("never")) + "\n";
+    }
+  }
+}
@@ -0,0 +1,210 @@
+#include "../include/AdcCapture.h"
+#include "../config.h"
+
+#include <driver/i2s.h>
+#include <driver/adc.h>
+
+#define CAPTURE_I2S_PORT I2S_NUM_0
+
+// DMA buffers, each one block long, so a slow consumer has some slack.
+#define CAPTURE_DMA_BUFFERS 4
+
+namespace AdcCapture {
+  namespace {
+    typedef struct CaptureConsumer {
+      const char *name;
+      SampleBuffer<SampleBlock*, ADC_CAPTURE_QUEUE_SIZE> queue;
+      uint32_t dropped;
+    } CaptureConsumer;
+
+    TaskHandle_t task = nullptr;
+    volatile bool stopping = false;
+    uint32_t sample_rate_hz = 0;
+    uint32_t sequence = 0;
+    int64_t start_us = 0;
+    uint64_t samples_total = 0;
+
+    SampleBlockPool<ADC_CAPTURE_POOL_SIZE> pool;
+    CaptureConsumer consumers[ADC_CAPTURE_MAX_CONSUMERS];
+    std::atomic<int> consumer_count(0);
+    portMUX_TYPE subscribe_mux = portMUX_INITIALIZER_UNLOCKED;
+    CaptureStats stats = {0};
+
+    // DMA has to be drained somewhere when the pool is empty.
+    uint16_t overrun_samples[SAMPLE_BLOCK_SIZE];
+
+    /**
+     * Hands a reference to `block` to every consumer. A consumer whose queue
+     * is full misses this block, rather than holding up the others.
+     */
+    void publish(SampleBlock *block) {
+      int count = consumer_count.load(std::memory_order_acquire);
+
+      for (int i = 0; i < count; i++) {
+        SampleBlockPool<ADC_CAPTURE_POOL_SIZE>::retain(block);
+
+        if (!consumers[i].queue.push(block)) {
+          SampleBlockPool<ADC_CAPTURE_POOL_SIZE>::release(block);
+          consumers[i].dropped++;
+        }
+      }
+    }
+
+    void captureTask(void*) {
+      while (!stopping) {
+        SampleBlock *block = pool.acquire();
+        uint16_t *dest = block != nullptr ? block->samples : overrun_samples;
+        size_t bytes_read = 0;
+
+        i2s_read(CAPTURE_I2S_PORT, dest, SAMPLE_BLOCK_SIZE * sizeof(uint16_t), &bytes_read, portMAX_DELAY);
+        size_t count = bytes_read / sizeof(uint16_t);
+        int64_t timestamp_us = start_us + (int64_t)(samples_total * 1000000 / sample_rate_hz);
+        samples_total += count;
+
+        if (block == nullptr) {
+          stats.overruns++;
+          continue;
+        }
+
+        // The top nibble is the ADC channel:
+        for (size_t i = 0; i < count; i++) {
+          block->samples[i] &= 0x0FFF;
+        }
+
+        block->sequence = sequence++;
+        block->timestamp_us = timestamp_us;
+        block->sample_rate_hz = sample_rate_hz;
+        block->count = count;
+
+        stats.blocks++;
+        stats.samples += count;
+
+        publish(block);
+        pool.release(block);
+      }
+
+      task = nullptr;
+      vTaskDelete(NULL);
+    }
+  }
+
+  bool begin(uint32_t rate_hz) {
+    if (running()) {
+      end();
+    }
+
+    i2s_config_t i2s_config = {
+      .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN),
+      .sample_rate = (int) rate_hz,
+      .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+      .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
+      .communication_format = I2S_COMM_FORMAT_I2S_MSB,
+      .intr_alloc_flags = 0,
+      .dma_buf_count = CAPTURE_DMA_BUFFERS,
+      .dma_buf_len = SAMPLE_BLOCK_SIZE,
+      .use_apll = false
+    };
+
+    if (i2s_driver_install(CAPTURE_I2S_PORT, &i2s_config, 0, NULL) != ESP_OK) {
+      Serial.println("ADC capture: I2S driver install failed.");
+      return false;
+    }
+
+    i2s_set_adc_mode(ADC_UNIT_1, BUTT_ADC_CHANNEL);
+    i2s_adc_enable(CAPTURE_I2S_PORT);
+
+    sample_rate_hz = rate_hz;
+    samples_total = 0;
+    stats = CaptureStats();
+    start_us = esp_timer_get_time();
+    stopping = false;
+
+    // Same core and priority as the Sampler it replaces.
+    if (xTaskCreatePinnedToCore(captureTask, "adcCapture", 4096, NULL,
+                                configMAX_PRIORITIES - 2, &task, 0) != pdPASS) {
+      Serial.println("ADC capture: failed to start task.");
+      task = nullptr;
+      i2s_adc_disable(CAPTURE_I2S_PORT);
+      i2s_driver_uninstall(CAPTURE_I2S_PORT);
+      return false;
+    }
+
+    Serial.println("ADC capture running at " + String(rate_hz) + " Hz.");
+    return true;
+  }
+
+  void end() {
+    if (!running()) {
+      return;
+    }
+
+    // The task notices between blocks.
+    stopping = true;
+    for (int i = 0; i < 100 && task != nullptr; i++) {
+      delay(5);
+    }
+
+    i2s_adc_disable(CAPTURE_I2S_PORT);
+    i2s_driver_uninstall(CAPTURE_I2S_PORT);
+  }
+
+  bool running() {
+    return task != nullptr && !stopping;
+  }
+
+  uint32_t getSampleRate() {
+    return sample_rate_hz;
+  }
+
+  int subscribe(const char *name) {
+    int id = -1;
+
+    portENTER_CRITICAL(&subscribe_mux);
+    int count = consumer_count.load(std::memory_order_relaxed);
+    if (count < ADC_CAPTURE_MAX_CONSUMERS) {
+      id = count;
+      consumers[id].name = name;
+      consumers[id].dropped = 0;
+      consumer_count.store(count + 1, std::memory_order_release);
+    }
+    portEXIT_CRITICAL(&subscribe_mux);
+
+    return id;
+  }
+
+  /**
+   * Next block for this consumer, if any. The caller owns a reference to it
+   * and must release() it.
+   */
+  bool receive(int consumer, SampleBlock *&block) {
+    if (consumer < 0 || consumer >= consumer_count.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    return consumers[consumer].queue.pop(block);
+  }
+
+  void release(SampleBlock *block) {
+    SampleBlockPool<ADC_CAPTURE_POOL_SIZE>::release(block);
+  }
+
+  void getStats(CaptureStats &out) {
+    out = stats;
+  }
+
+  void printStats(String &out) {
+    if (!running()) {
+      out += "ADC capture not running.\n";
+      return;
+    }
+
+    out += "Rate: " + String(sample_rate_hz) + " Hz, " + String(SAMPLE_BLOCK_SIZE) + " samples/block\n";
+    out += "Blocks: " + String(stats.blocks) + ", overruns: " + String(stats.overruns) + "\n";
+    out += "Pool: " + String(pool.inUse()) + "/" + String(ADC_CAPTURE_POOL_SIZE) + " in use\n";
+
+    for (int i = 0; i < consumer_count.load(); i++) {
+      out += String(consumers[i].name) + ": " + String(consumers[i].queue.available()) +
+             " waiting, " + String(consumers[i].dropped) + " dropped\n";
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#include "../include/ArousalDetector.h"
+
+namespace ArousalDetectors {
+  namespace {
+    PeakDetector Peak;
+    SlopeDetector Slope;
+    BandEnergyDetector BandEnergy;
+    AdaptiveDetector Adaptive;
+
+    // The first entry is the default.
+    ArousalDetector *detectors[] = {
+      &Peak,
+      &Slope,
+      &BandEnergy,
+      &Adaptive
+    };
+  }
+
+  size_t count() {
+    return sizeof(detectors) / sizeof(detectors[0]);
+  }
+
+  ArousalDetector *get(size_t index) {
+    return index < count() ? detectors[index] : nullptr;
+  }
+
+  ArousalDetector *find(const char *name) {
+    for (size_t i = 0; i < count(); i++) {
+      if (!strcmp(detectors[i]->getName(), name)) {
+        return detectors[i];
+      }
+    }
+
+    return nullptr;
+  }
+
+  void printStats(String &out, ArousalDetector *active) {
+    for (size_t i = 0; i < count(); i++) {
+      ArousalDetector *d = detectors[i];
+      const DetectorStats &s = d->getStats();
+
+      out += String(d->getName());
+      if (d == active) {
+        out += " (active)";
+      }
+
+      if (s.ticks == 0) {
+        out += ": not run\n";
+        continue;
+      }
+
+      out += ": " + String(s.ticks) + " ticks, mean " +
+             String((float) s.total_us / s.ticks, 2) + " us, max " +
+             String(s.max_us) + " us\n";
+    }
+  }
+}
@@ -0,0 +1,171 @@
+#include "../include/AutoCalibration.h"
+#include "../include/OrgasmControl.h"
+#include "../include/Hardware.h"
+#include "../include/UserInterface.h"
+
+namespace AutoCalibration {
+  void start() {
+    state = CalibrationWarmUp;
+    started_ms = millis();
+    baseline = 0;
+    typical_peak = 0;
+    windows = 0;
+    warmup_threshold = 0;
+    resetWindow(started_ms);
+
+    Serial.println("Calibration started.");
+    UI.toast("Calibrating...\nRelax for a minute.");
+  }
+
+  void stop() {
+    if (state == CalibrationOff) {
+      return;
+    }
+
+    state = CalibrationOff;
+    Serial.println("Calibration stopped.");
+  }
+
+  CalibrationState getState() {
+    return state;
+  }
+
+  bool active() {
+    return state != CalibrationOff;
+  }
+
+  void update(const Reading &reading) {
+    if (state == CalibrationOff) {
+      return;
+    }
+
+    window_min_pressure = min(window_min_pressure, (long) reading.avg_pressure);
+    window_peak_arousal = max(window_peak_arousal, (long) reading.arousal);
+
+    if (OrgasmControl::getDenialCount() != window_denials) {
+      window_denials = -1; // Marks the window, see adjustThreshold()
+    }
+
+    if ((long) reading.millis - window_start_ms >= CAL_WINDOW_MS) {
+      endWindow(reading.millis);
+    }
+  }
+
+  void printStatus(String &out) {
+    switch (state) {
+      case CalibrationOff:
+        out += "Calibration off.\n";
+        return;
+      case CalibrationWarmUp:
+        out += "Warming up, " + String((CAL_WARMUP_MS - (long)(millis() - started_ms)) / 1000) + " s left\n";
+        break;
+      case CalibrationTracking:
+        out += "Tracking\n";
+        break;
+    }
+
+    out += "Baseline: " + String((long) baseline) + " (target " + String(CAL_TARGET_PRESSURE) + ")\n";
+    out += "Typical peak: " + String((long) typical_peak) + "\n";
+    out += "Sensitivity: " + String(Config.sensor_sensitivity) + ", threshold: " +
+           String(Config.sensitivity_threshold) + "\n";
+  }
+
+  namespace {
+    void endWindow(long now_ms) {
+      // The first window has the plug settling in, and the filters priming.
+      if (windows++ == 0) {
+        resetWindow(now_ms);
+        return;
+      }
+
+      // Resting pressure is the bottom of the window; contractions only add.
+      if (baseline <= 0) {
+        baseline = window_min_pressure;
+      } else {
+        baseline += (window_min_pressure - baseline) * 0.5f;
+      }
+
+      adjustSensitivity();
+
+      if (state == CalibrationWarmUp) {
+        typical_peak = max(typical_peak, (float) window_peak_arousal);
+
+        if (now_ms - started_ms >= CAL_WARMUP_MS) {
+          warmup_threshold = constrain((int)(typical_peak * CAL_THRESHOLD_MARGIN),
+                                       CAL_THRESHOLD_MIN, CAL_THRESHOLD_MAX);
+          Config.sensitivity_threshold = warmup_threshold;
+          state = CalibrationTracking;
+
+          Serial.println("Calibrated: threshold " + String(Config.sensitivity_threshold) +
+                         ", sensitivity " + String(Config.sensor_sensitivity));
+          UI.toast("Calibrated!");
+          saveConfigToSd(millis() + 1000);
+        }
+      } else {
+        adjustThreshold();
+      }
+
+      resetWindow(now_ms);
+    }
+
+    /**
+     * Steps the digipot toward putting the baseline at CAL_TARGET_PRESSURE.
+     * The gain is about proportional to the setting, so aim for the
+     * proportional setting, but move at most CAL_SENSITIVITY_STEP.
+     */
+    void adjustSensitivity() {
+      if (baseline <= 0) {
+        return;
+      }
+
+      // Dead band, so it doesn't hunt around the target:
+      if (abs(baseline - CAL_TARGET_PRESSURE) < CAL_TARGET_PRESSURE / 20) {
+        return;
+      }
+
+      int current = Config.sensor_sensitivity;
+      int desired = current * CAL_TARGET_PRESSURE / baseline;
+      int next = current + constrain(desired - current, -CAL_SENSITIVITY_STEP, CAL_SENSITIVITY_STEP);
+      next = constrain(next, CAL_SENSITIVITY_MIN, CAL_SENSITIVITY_MAX);
+
+      if (next == current) {
+        return;
+      }
+
+      Config.sensor_sensitivity = next;
+      Hardware::setPressureSensitivity(next);
+
+      // Assume the new gain, until the next window measures it.
+      baseline = baseline * next / current;
+    }
+
+    /**
+     * Moves the threshold toward CAL_THRESHOLD_MARGIN times the typical
+     * peak, learning only from windows which stayed under it with no denial.
+     */
+    void adjustThreshold() {
+      int threshold = Config.sensitivity_threshold;
+
+      if (window_denials < 0 || window_peak_arousal >= threshold) {
+        return;
+      }
+
+      typical_peak = max(typical_peak * CAL_PEAK_DECAY, (float) window_peak_arousal);
+
+      int desired = typical_peak * CAL_THRESHOLD_MARGIN;
+      desired = constrain(desired, (int)(warmup_threshold / CAL_THRESHOLD_RANGE),
+                          (int)(warmup_threshold * CAL_THRESHOLD_RANGE));
+      desired = constrain(desired, CAL_THRESHOLD_MIN, CAL_THRESHOLD_MAX);
+
+      int max_step = max((int)(threshold * CAL_THRESHOLD_STEP), 1);
+      Config.sensitivity_threshold = threshold + constrain(desired - threshold, -max_step, max_step);
+    }
+
+    void resetWindow(long now_ms) {
+      window_start_ms = now_ms;
+      window_min_pressure = UINT16_MAX;
+      window_peak_arousal = 0;
+      window_denials = OrgasmControl::getDenialCount();
+    }
+  }
+}
@@ -0,0 +1,49 @@
+#include "../include/BaselineTracker.h"
+
+void BaselineTracker::addValue(long value) {
+  if (!primed) {
+    for (size_t i = 0; i < BASELINE_BLOCKS; i++) {
+      minima[i] = value;
+    }
+
+    baseline = int_to_fixed(value);
+    primed = true;
+  }
+
+  // Start a new block, dropping the oldest one out of the window:
+  if (block_fill >= block_size) {
+    block = (block + 1) % BASELINE_BLOCKS;
+    minima[block] = value;
+    block_fill = 0;
+  }
+
+  minima[block] = min(minima[block], value);
+  block_fill++;
+
+  baseline += fixed_mul(int_to_fixed(windowMinimum()) - baseline, alpha);
+}
+
+void BaselineTracker::reset() {
+  primed = false;
+  block_fill = 0;
+}
+
+/**
+ * Takes effect from the next block. History is kept, so the baseline
+ * doesn't jump.
+ */
+void BaselineTracker::setWindow(size_t samples) {
+  block_size = max(samples / BASELINE_BLOCKS, (size_t) 1);
+  alpha = FIXED_ONE / (fixed_t) block_size;
+}
+
+// Private
+
+long BaselineTracker::windowMinimum() {
+  long lowest = minima[0];
+  for (size_t i = 1; i < BASELINE_BLOCKS; i++) {
+    lowest = min(lowest, minima[i]);
+  }
+
+  return lowest;
+}
@@ -0,0 +1,174 @@
+#include "../include/Boot.h"
+
+#include <esp_timer.h>
+#include <freertos/event_groups.h>
+
+namespace Boot {
+  namespace {
+    const BootStage *stages = nullptr;
+    size_t stage_count = 0;
+    EventGroupHandle_t through = nullptr;
+
+    // Guards everything below, written by whichever stage task finishes.
+    portMUX_TYPE boot_mux = portMUX_INITIALIZER_UNLOCKED;
+    BootStageState states[BOOT_MAX_STAGES];
+    int64_t started_us[BOOT_MAX_STAGES];
+    int64_t ended_us[BOOT_MAX_STAGES];
+    uint32_t through_mask = 0;
+    uint32_t failed_mask = 0;
+
+    const char *getStateName(BootStageState state) {
+      switch (state) {
+        case BootStagePending:
+          return "pending";
+        case BootStageRunning:
+          return "running";
+        case BootStageDone:
+          return "ok";
+        case BootStageFailed:
+          return "FAILED";
+        case BootStageSkipped:
+          return "skipped";
+        default:
+          return "?";
+      }
+    }
+
+    void finish(size_t index, BootStageState state) {
+      bool all_through;
+
+      portENTER_CRITICAL(&boot_mux);
+      states[index] = state;
+      ended_us[index] = esp_timer_get_time();
+      through_mask |= BOOT_STAGE(index);
+      if (state != BootStageDone) {
+        failed_mask |= BOOT_STAGE(index);
+      }
+      all_through = through_mask == BOOT_STAGE(stage_count) - 1;
+      portEXIT_CRITICAL(&boot_mux);
+
+      xEventGroupSetBits(through, BOOT_STAGE(index));
+
+      if (all_through) {
+        String report;
+        printReport(report);
+        Serial.print(report);
+      }
+    }
+
+    void stageTask(void *param);
+
+    /**
+     * Starts every pending stage whose dependencies are through, skipping the
+     * ones where a dependency failed (which may in turn free up others).
+     */
+    void launchReady() {
+      for (;;) {
+        int ready = -1;
+        bool skip = false;
+
+        portENTER_CRITICAL(&boot_mux);
+        for (size_t i = 0; i < stage_count; i++) {
+          if (states[i] == BootStagePending && (stages[i].after & ~through_mask) == 0) {
+            ready = i;
+            skip = (stages[i].after & failed_mask) != 0;
+            states[i] = skip ? BootStageSkipped : BootStageRunning;
+            started_us[i] = esp_timer_get_time();
+            break;
+          }
+        }
+        portEXIT_CRITICAL(&boot_mux);
+
+        if (ready < 0) {
+          return;
+        }
+
+        if (skip) {
+          finish(ready, BootStageSkipped);
+          continue;
+        }
+
+        if (xTaskCreatePinnedToCore(stageTask, stages[ready].name, BOOT_STAGE_STACK,
+                                    (void*) (intptr_t) ready, 1, NULL, stages[ready].core) != pdPASS) {
+          Serial.println(String("Couldn't start boot stage ") + stages[ready].name + "!");
+          finish(ready, BootStageFailed);
+        }
+      }
+    }
+
+    void stageTask(void *param) {
+      size_t index = (intptr_t) param;
+      bool ok = stages[index].run();
+
+      finish(index, ok ? BootStageDone : BootStageFailed);
+      launchReady();
+      vTaskDelete(NULL);
+    }
+  }
+
+  void begin(const BootStage *table, size_t count) {
+    stages = table;
+    stage_count = min(count, (size_t) BOOT_MAX_STAGES);
+    through = xEventGroupCreate();
+
+    for (size_t i = 0; i < stage_count; i++) {
+      states[i] = BootStagePending;
+      started_us[i] = 0;
+      ended_us[i] = 0;
+    }
+
+    launchReady();
+  }
+
+  bool waitFor(uint32_t wanted) {
+    xEventGroupWaitBits(through, wanted, pdFALSE, pdTRUE, portMAX_DELAY);
+
+    portENTER_CRITICAL(&boot_mux);
+    bool ok = (failed_mask & wanted) == 0;
+    portEXIT_CRITICAL(&boot_mux);
+
+    return ok;
+  }
+
+  bool finished() {
+    portENTER_CRITICAL(&boot_mux);
+    bool all_through = stage_count > 0 && through_mask == BOOT_STAGE(stage_count) - 1;
+    portEXIT_CRITICAL(&boot_mux);
+
+    return all_through;
+  }
+
+  BootStageState getState(size_t index) {
+    return index < stage_count ? states[index] : BootStagePending;
+  }
+
+  void printReport(String &out) {
+    out += "Boot stages, ms since reset:\n";
+
+    for (size_t i = 0; i < stage_count; i++) {
+      BootStageState state;
+      int64_t start;
+      int64_t end;
+
+      portENTER_CRITICAL(&boot_mux);
+      state = states[i];
+      start = started_us[i];
+      end = ended_us[i];
+      portEXIT_CRITICAL(&boot_mux);
+
+      char line[64];
+      if (state == BootStagePending) {
+        snprintf(line, sizeof(line), "  %-10s %s\n", stages[i].name, getStateName(state));
+      } else if (state == BootStageRunning) {
+        snprintf(line, sizeof(line), "  %-10s %6ld .. %-6s %s\n", stages[i].name,
+                 (long) (start / 1000), "", getStateName(state));
+      } else {
+        snprintf(line, sizeof(line), "  %-10s %6ld .. %-6ld %5ld ms %s\n", stages[i].name,
+                 (long) (start / 1000), (long) (end / 1000), (long) ((end - start) / 1000),
+                 getStateName(state));
+      }
+
+      out += line;
+    }
+  }
+}
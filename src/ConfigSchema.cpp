@@ -0,0 +1,271 @@
+#include "../include/ConfigSchema.h"
+#include "../include/MotorOutput.h"
+#include "../include/Oversampler.h"
+
+#include <stddef.h>
+#include <type_traits>
+
+/**
+ * Offset of a ConfigStruct field, which only compiles if the field's type is
+ * what the table entry says it is.
+ */
+template <typename Expected, typename Field>
+constexpr uint16_t fieldOffset(size_t offset) {
+  return std::is_same<Expected, typename std::decay<Field>::type>::value ?
+         offset : throw "Config schema entry doesn't match the field's type";
+}
+
+#define CONFIG_KEY(name, type, ctype, def, def_str, lo, hi, flags) \
+  { #name, type, flags, fieldOffset<ctype, decltype(ConfigStruct::name)>(offsetof(ConfigStruct, name)), \
+    sizeof(ConfigStruct::name), def, def_str, lo, hi }
+
+#define CONFIG_BOOL(name, def, flags)         CONFIG_KEY(name, ConfigBool, bool, def, nullptr, 0, 1, flags)
+#define CONFIG_BYTE(name, def, lo, hi, flags) CONFIG_KEY(name, ConfigByte, byte, def, nullptr, lo, hi, flags)
+#define CONFIG_INT(name, def, lo, hi, flags)  CONFIG_KEY(name, ConfigInt, int, def, nullptr, lo, hi, flags)
+#define CONFIG_STRING(name, def, flags)       CONFIG_KEY(name, ConfigString, char*, 0, def, 0, 0, flags)
+
+// Sorted by key. See README.md for what each one does.
+static constexpr ConfigKey schema[] = {
+  CONFIG_STRING(accessory_scale, "", CONFIG_ACCESSORIES),
+  CONFIG_INT(adc_capture_hz, 0, 0, 200000, CONFIG_REBOOT),
+  CONFIG_STRING(arousal_detector, "peak", 0),
+  CONFIG_BOOL(auto_calibrate, false, CONFIG_CALIBRATION),
+  CONFIG_INT(baseline_window_s, 30, 0, 3600, 0),
+  CONFIG_STRING(bt_display_name, "NoGasm WiFi", 0),
+  CONFIG_BOOL(bt_on, false, CONFIG_REBOOT),
+  CONFIG_BOOL(classic_serial, false, 0),
+  CONFIG_INT(edge_lead_ms, 0, 0, 10000, 0),
+  CONFIG_BYTE(led_brightness, 128, 0, 255, 0),
+  CONFIG_BYTE(motor_max_speed, 128, 0, 255, 0),
+  CONFIG_STRING(motor_pattern, "steady", 0),
+  CONFIG_STRING(motor_profile, "scurve", CONFIG_MOTOR),
+  CONFIG_INT(motor_pwm_hz, 5000, 1, MOTOR_PWM_CLOCK_HZ >> MOTOR_PWM_MIN_BITS, CONFIG_MOTOR),
+  CONFIG_INT(motor_ramp_time_s, 30, 0, 3600, 0),
+  CONFIG_INT(motor_slew_ms, 200, 0, 10000, CONFIG_MOTOR),
+  CONFIG_STRING(pressure_filter, "boxcar", 0),
+  CONFIG_BYTE(pressure_oversampling, 8, 1, OVERSAMPLE_MAX, 0),
+  CONFIG_BYTE(pressure_smoothing, 5, 1, 255, 0),
+  CONFIG_INT(screen_dim_seconds, 10, 0, 86400, 0),
+  CONFIG_INT(screen_max_fps, 30, 0, 120, 0),
+  CONFIG_INT(screen_timeout_seconds, 60, 0, 86400, 0),
+  // Compared as Q16.16 arousal, so no higher than its integer part goes:
+  CONFIG_INT(sensitivity_threshold, 600, 0, 32767, 0),
+  CONFIG_BYTE(sensor_sensitivity, 128, 0, 255, CONFIG_SENSITIVITY),
+  CONFIG_INT(update_frequency_hz, 50, 1, 1000, 0),
+  CONFIG_BOOL(use_average_values, false, 0),
+  CONFIG_INT(websocket_port, 80, 1, 65535, CONFIG_REBOOT),
+  CONFIG_STRING(wifi_key, "", 0),
+  CONFIG_BOOL(wifi_on, false, CONFIG_REBOOT),
+  CONFIG_STRING(wifi_ssid, "", 0),
+};
+
+#define CONFIG_KEYS (sizeof(schema) / sizeof(ConfigKey))
+
+namespace {
+  constexpr int compareKeys(const char *a, const char *b) {
+    return *a != *b ? (unsigned char) *a - (unsigned char) *b :
+           *a == '\0' ? 0 : compareKeys(a + 1, b + 1);
+  }
+
+  constexpr bool validFrom(size_t i) {
+    return i >= CONFIG_KEYS || (
+        (i + 1 >= CONFIG_KEYS || compareKeys(schema[i].key, schema[i + 1].key) < 0) &&
+        (schema[i].type == ConfigString ||
+            (schema[i].default_value >= schema[i].min && schema[i].default_value <= schema[i].max)) &&
+        validFrom(i + 1));
+  }
+
+  // FNV-1a, over the name, type and place of every key:
+  constexpr uint32_t hashByte(uint32_t hash, uint32_t byte) {
+    return (hash ^ (byte & 0xFF)) * 16777619u;
+  }
+
+  constexpr uint32_t hashString(uint32_t hash, const char *s) {
+    return *s == '\0' ? hashByte(hash, 0) : hashString(hashByte(hash, (unsigned char) *s), s + 1);
+  }
+
+  constexpr uint32_t hashKey(uint32_t hash, const ConfigKey &key) {
+    return hashByte(hashByte(hashByte(hashByte(hashByte(hashString(hash, key.key),
+        key.type), key.offset), key.offset >> 8), key.size), key.size >> 8);
+  }
+
+  constexpr uint32_t hashFrom(size_t i, uint32_t hash) {
+    return i >= CONFIG_KEYS ? hashByte(hashByte(hash, sizeof(ConfigStruct)), sizeof(ConfigStruct) >> 8) :
+           hashFrom(i + 1, hashKey(hash, schema[i]));
+  }
+
+  constexpr uint32_t schema_version = hashFrom(0, 2166136261u);
+}
+
+static_assert(validFrom(0), "Config schema keys must be sorted and unique, with defaults in range.");
+static_assert(CONFIG_KEYS <= sizeof(ConfigKeySet) * 8, "Too many config keys for a ConfigKeySet.");
+
+/**
+ * Cast a string to a bool. Accepts "false", "no", "off", "0" to false, all other
+ * strings cast to true.
+ * @param a
+ * @return
+ */
+static bool atob(const char *a) {
+  return !(
+      strcmp(a, "false") == 0 ||
+      strcmp(a, "no") == 0 ||
+      strcmp(a, "off") == 0 ||
+      strcmp(a, "0") == 0
+  );
+}
+
+namespace ConfigSchema {
+  namespace {
+    void *field(const ConfigKey &key, ConfigStruct &to) {
+      return (uint8_t*) &to + key.offset;
+    }
+
+    const void *field(const ConfigKey &key, const ConfigStruct &from) {
+      return (const uint8_t*) &from + key.offset;
+    }
+  }
+
+  size_t count() {
+    return CONFIG_KEYS;
+  }
+
+  uint32_t version() {
+    return schema_version;
+  }
+
+  const ConfigKey *get(size_t index) {
+    return index < CONFIG_KEYS ? &schema[index] : nullptr;
+  }
+
+  const ConfigKey *find(const char *key) {
+    size_t lo = 0;
+    size_t hi = CONFIG_KEYS;
+
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      int cmp = strcmp(key, schema[mid].key);
+
+      if (cmp == 0) {
+        return &schema[mid];
+      } else if (cmp < 0) {
+        hi = mid;
+      } else {
+        lo = mid + 1;
+      }
+    }
+
+    return nullptr;
+  }
+
+  void loadDefaults() {
+    for (size_t i = 0; i < CONFIG_KEYS; i++) {
+      const ConfigKey &key = schema[i];
+      if (key.type == ConfigString) {
+        setString(key, key.default_string);
+      } else {
+        setLong(key, key.default_value);
+      }
+    }
+  }
+
+  void setLong(const ConfigKey &key, long value, ConfigStruct &to) {
+    value = constrain(value, key.min, key.max);
+
+    switch (key.type) {
+      case ConfigBool:
+        *(bool*) field(key, to) = value != 0;
+        break;
+      case ConfigByte:
+        *(byte*) field(key, to) = value;
+        break;
+      case ConfigInt:
+        *(int*) field(key, to) = value;
+        break;
+      case ConfigString:
+        break;
+    }
+  }
+
+  void setString(const ConfigKey &key, const char *value, ConfigStruct &to) {
+    if (key.type == ConfigString) {
+      strlcpy((char*) field(key, to), value != nullptr ? value : "", key.size);
+    }
+  }
+
+  void validate(ConfigStruct &to) {
+    for (size_t i = 0; i < CONFIG_KEYS; i++) {
+      const ConfigKey &key = schema[i];
+
+      switch (key.type) {
+        case ConfigBool:
+          // Any byte but 0 or 1 isn't a valid bool to read:
+          *(uint8_t*) field(key, to) = *(uint8_t*) field(key, to) != 0;
+          break;
+        case ConfigString:
+          ((char*) field(key, to))[key.size - 1] = '\0';
+          break;
+        default:
+          setLong(key, getLong(key, to), to);
+          break;
+      }
+    }
+  }
+
+  void parse(const ConfigKey &key, const char *value) {
+    switch (key.type) {
+      case ConfigBool:
+        setLong(key, atob(value));
+        break;
+      case ConfigByte:
+      case ConfigInt:
+        setLong(key, atol(value));
+        break;
+      case ConfigString:
+        setString(key, value);
+        break;
+    }
+  }
+
+  long getLong(const ConfigKey &key, const ConfigStruct &from) {
+    switch (key.type) {
+      case ConfigBool:
+        return *(const bool*) field(key, from);
+      case ConfigByte:
+        return *(const byte*) field(key, from);
+      case ConfigInt:
+        return *(const int*) field(key, from);
+      default:
+        return 0;
+    }
+  }
+
+  const char *getString(const ConfigKey &key, const ConfigStruct &from) {
+    return key.type == ConfigString ? (const char*) field(key, from) : "";
+  }
+
+  void print(const ConfigKey &key, String &out) {
+    if (key.type == ConfigString) {
+      out += String(getString(key)) + '\n';
+    } else {
+      out += String(getLong(key)) + '\n';
+    }
+  }
+
+  ConfigKeySet diff(const ConfigStruct &a, const ConfigStruct &b) {
+    ConfigKeySet keys = 0;
+
+    for (size_t i = 0; i < CONFIG_KEYS; i++) {
+      const ConfigKey &key = schema[i];
+      bool same = key.type == ConfigString ?
+                  strncmp(getString(key, a), getString(key, b), key.size) == 0 :
+                  getLong(key, a) == getLong(key, b);
+
+      if (!same) {
+        keys |= (ConfigKeySet) 1 << i;
+      }
+    }
+
+    return keys;
+  }
+}
@@ -0,0 +1,412 @@
+#include "../include/ConfigStore.h"
+#include "../include/ConfigSchema.h"
+
+#include <SD.h>
+#include <Preferences.h>
+#include <esp_timer.h>
+
+namespace ConfigStore {
+  namespace {
+    // Loop only: the config as of the last commit(), and as loaded from flash.
+    ConfigStruct committed;
+    ConfigStruct booted;
+
+    // Guards the handover from commit() to tick(), and back for reconciling.
+    portMUX_TYPE store_mux = portMUX_INITIALIZER_UNLOCKED;
+    ConfigStruct pending;
+    ConfigKeySet pending_keys = 0;
+    bool compact_requested = false;
+    bool cache_requested = false;
+    bool reconcile_requested = false;
+    ConfigStruct reconciled;
+    bool reconciled_ready = false;
+    const char *error = nullptr;
+
+    // Background only, once loadCached() and load() are done.
+    Preferences prefs;
+    bool prefs_open = false;
+    ConfigStruct cached;
+    bool cache_valid = false;
+    bool booted_from_cache = false;
+    bool card = false;
+    uint32_t cache_writes = 0;
+    int journal_entries = 0;
+    uint32_t retry_at = 0;
+    uint32_t entries_written = 0;
+    uint32_t compactions = 0;
+    uint32_t failures = 0;
+    uint32_t last_write_us = 0;
+
+    void fail(const char *code, const __FlashStringHelper *message) {
+      Serial.println(message);
+      failures++;
+
+      // Only report the first of a run of retries:
+      if (retry_at != 0) {
+        return;
+      }
+
+      portENTER_CRITICAL(&store_mux);
+      error = code;
+      portEXIT_CRITICAL(&store_mux);
+    }
+
+    bool appendJournal(const ConfigStruct &snapshot, ConfigKeySet keys) {
+      DynamicJsonDocument doc(2048);
+      dumpConfigToJsonObject(doc, snapshot, keys);
+
+      File journal = SD.open(CONFIG_JOURNAL_FILENAME, FILE_APPEND);
+      if (!journal) {
+        fail(E_SAV_LOG, F("Failed to open the config journal!"));
+        return false;
+      }
+
+      // One line per entry, so a line cut short only loses itself:
+      size_t written = serializeJson(doc, journal);
+      written += journal.print('\n');
+      journal.close();
+
+      if (written != measureJson(doc) + 1) {
+        fail(E_SAV_LOG, F("Failed to append to the config journal!"));
+        return false;
+      }
+
+      journal_entries++;
+      entries_written++;
+      return true;
+    }
+
+    bool compact(const ConfigStruct &snapshot) {
+      DynamicJsonDocument doc(2048);
+      dumpConfigToJsonObject(doc, snapshot, CONFIG_ALL_KEYS);
+
+      SD.remove(CONFIG_TEMP_FILENAME);
+      File tmp = SD.open(CONFIG_TEMP_FILENAME, FILE_WRITE);
+      if (!tmp) {
+        fail(E_SAV_TMP, F("Failed to create temp file for config save!"));
+        return false;
+      }
+
+      size_t written = serializeJsonPretty(doc, tmp);
+      tmp.close();
+
+      if (written == 0 || written != measureJsonPretty(doc)) {
+        fail(E_SAV_SER, F("Failed to serialize config to file!"));
+        SD.remove(CONFIG_TEMP_FILENAME);
+        return false;
+      }
+
+      // FAT can't rename over a file, so the old one steps aside first:
+      if (SD.exists(CONFIG_FILENAME)) {
+        SD.remove(CONFIG_BACKUP_FILENAME);
+        if (!SD.rename(CONFIG_FILENAME, CONFIG_BACKUP_FILENAME)) {
+          fail(E_SAV_BAK, F("Failed to save over existing config!"));
+          return false;
+        }
+      }
+
+      if (!SD.rename(CONFIG_TEMP_FILENAME, CONFIG_FILENAME)) {
+        fail(E_SAV_BAK, F("Failed to move new config into place!"));
+        return false;
+      }
+
+      // Everything in the journal is in config.json now:
+      SD.remove(CONFIG_JOURNAL_FILENAME);
+      journal_entries = 0;
+      compactions++;
+      return true;
+    }
+
+    bool openCache() {
+      if (!prefs_open) {
+        prefs_open = prefs.begin(CONFIG_NVS_NAMESPACE, false);
+      }
+
+      return prefs_open;
+    }
+
+    void storeCached(const ConfigStruct &snapshot) {
+      if (cache_valid && ConfigSchema::diff(snapshot, cached) == 0) {
+        return;
+      }
+
+      // The version goes last, so a cut short update doesn't pass for current:
+      if (!openCache() || prefs.putBytes("struct", &snapshot, sizeof(ConfigStruct)) != sizeof(ConfigStruct)) {
+        Serial.println(F("Failed to cache config in flash!"));
+        failures++;
+        return;
+      }
+
+      if (prefs.getUInt("version", 0) != ConfigSchema::version()) {
+        prefs.putUInt("version", ConfigSchema::version());
+      }
+
+      cached = snapshot;
+      cache_valid = true;
+      cache_writes++;
+    }
+
+    void reconcile() {
+      DynamicJsonDocument doc(4096);
+
+      // Keys the card doesn't have keep what was cached:
+      ConfigStruct from_sd = cached;
+
+      if (!load(doc) || doc.size() == 0) {
+        Serial.println(F("No usable config on the SD card, writing the cached one there."));
+        compactSoon();
+        return;
+      }
+
+      loadConfigFromJsonObject(doc, from_sd);
+
+      portENTER_CRITICAL(&store_mux);
+      reconciled = from_sd;
+      reconciled_ready = true;
+      portEXIT_CRITICAL(&store_mux);
+    }
+  }
+
+  bool load(JsonDocument &doc) {
+    card = true;
+
+    // A compaction that was cut short leaves the new config as the temp
+    // file, or at least the old one as the backup:
+    if (!SD.exists(CONFIG_FILENAME)) {
+      if (SD.exists(CONFIG_TEMP_FILENAME)) {
+        Serial.println(F("Recovering config.json from an unfinished save."));
+        SD.rename(CONFIG_TEMP_FILENAME, CONFIG_FILENAME);
+      } else if (SD.exists(CONFIG_BACKUP_FILENAME)) {
+        Serial.println(F("Recovering config.json from its backup."));
+        SD.rename(CONFIG_BACKUP_FILENAME, CONFIG_FILENAME);
+      }
+    }
+
+    bool found = SD.exists(CONFIG_FILENAME);
+    if (found) {
+      File configFile = SD.open(CONFIG_FILENAME);
+      DeserializationError e = deserializeJson(doc, configFile);
+      configFile.close();
+
+      if (e) {
+        Serial.println(F("Failed to deserialize JSON, using default config!"));
+        Serial.println(F("^-- This means no WiFi. Please ensure your SD card has config.json present."));
+        Serial.println(e.c_str());
+        doc.clear();
+      }
+    }
+
+    // Replay the journal over it, newest last:
+    journal_entries = 0;
+    File journal = SD.open(CONFIG_JOURNAL_FILENAME);
+    if (journal) {
+      DynamicJsonDocument entry(2048);
+
+      while (journal.available()) {
+        String line = journal.readStringUntil('\n');
+        if (deserializeJson(entry, line)) {
+          Serial.println(F("Config journal ends in a partial entry, skipping it."));
+          compactSoon();
+          break;
+        }
+
+        for (JsonPair kv : entry.as<JsonObject>()) {
+          doc[String(kv.key().c_str())] = kv.value();
+        }
+
+        journal_entries++;
+      }
+
+      journal.close();
+      found = true;
+    }
+
+    return found;
+  }
+
+  void markSaved() {
+    committed = Config;
+
+    portENTER_CRITICAL(&store_mux);
+    pending = Config;
+    pending_keys = 0;
+    cache_requested = true;
+    portEXIT_CRITICAL(&store_mux);
+  }
+
+  bool loadCached() {
+    if (!openCache() ||
+        prefs.getUInt("version", 0) != ConfigSchema::version() ||
+        prefs.getBytesLength("struct") != sizeof(ConfigStruct)) {
+      Serial.println(F("No config cached in flash for this version."));
+      return false;
+    }
+
+    ConfigStruct loaded;
+    if (prefs.getBytes("struct", &loaded, sizeof(ConfigStruct)) != sizeof(ConfigStruct)) {
+      return false;
+    }
+
+    ConfigSchema::validate(loaded);
+    Config = loaded;
+    booted = loaded;
+    cached = loaded;
+    cache_valid = true;
+    booted_from_cache = true;
+
+    committed = Config;
+    portENTER_CRITICAL(&store_mux);
+    pending = Config;
+    pending_keys = 0;
+    portEXIT_CRITICAL(&store_mux);
+
+    return true;
+  }
+
+  void reconcileSoon() {
+    portENTER_CRITICAL(&store_mux);
+    reconcile_requested = true;
+    portEXIT_CRITICAL(&store_mux);
+  }
+
+  ConfigKeySet takeReconciled(ConfigStruct &from_sd) {
+    bool ready;
+
+    portENTER_CRITICAL(&store_mux);
+    ready = reconciled_ready;
+    if (ready) {
+      from_sd = reconciled;
+      reconciled_ready = false;
+    }
+    portEXIT_CRITICAL(&store_mux);
+
+    if (!ready) {
+      return 0;
+    }
+
+    // What was changed here since boot is newer, and on its way to the card:
+    return ConfigSchema::diff(from_sd, Config) & ~ConfigSchema::diff(Config, booted);
+  }
+
+  ConfigKeySet commit() {
+    ConfigKeySet changed = ConfigSchema::diff(Config, committed);
+    if (changed == 0) {
+      return 0;
+    }
+
+    committed = Config;
+
+    portENTER_CRITICAL(&store_mux);
+    pending = Config;
+    pending_keys |= changed;
+    portEXIT_CRITICAL(&store_mux);
+
+    return changed;
+  }
+
+  void compactSoon() {
+    portENTER_CRITICAL(&store_mux);
+    compact_requested = true;
+    portEXIT_CRITICAL(&store_mux);
+  }
+
+  void tick() {
+    bool reconciling;
+
+    portENTER_CRITICAL(&store_mux);
+    reconciling = reconcile_requested;
+    reconcile_requested = false;
+    portEXIT_CRITICAL(&store_mux);
+
+    if (reconciling) {
+      reconcile();
+    }
+
+    if (retry_at != 0 && (int32_t) (millis() - retry_at) < 0) {
+      return;
+    }
+
+    ConfigStruct snapshot;
+    ConfigKeySet keys;
+    bool compacting;
+    bool caching;
+
+    portENTER_CRITICAL(&store_mux);
+    keys = pending_keys;
+    compacting = compact_requested;
+    caching = cache_requested;
+    if (keys != 0 || compacting || caching) {
+      snapshot = pending;
+      pending_keys = 0;
+      compact_requested = false;
+      cache_requested = false;
+    }
+    portEXIT_CRITICAL(&store_mux);
+
+    if (keys == 0 && !compacting && !caching) {
+      return;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    bool ok = true;
+
+    if (keys != 0 || caching) {
+      storeCached(snapshot);
+    }
+
+    // Without a card, flash is all there is:
+    if (!card) {
+      last_write_us = esp_timer_get_time() - start_us;
+      return;
+    }
+
+    // A compaction rewrites everything anyway, and after a failed append the
+    // journal may end in half a line that a new one would follow:
+    if (keys != 0 && !compacting) {
+      ok = appendJournal(snapshot, keys);
+    }
+
+    // The snapshot covers everything journaled so far, so it can replace it:
+    if (ok && (compacting || journal_entries >= CONFIG_JOURNAL_MAX_ENTRIES)) {
+      compacting = true;
+      ok = compact(snapshot);
+    }
+
+    last_write_us = esp_timer_get_time() - start_us;
+
+    if (ok) {
+      retry_at = 0;
+      return;
+    }
+
+    // Keep what didn't make it for the next try. A failed append may have
+    // left half a line, which would hide anything after it, so that try
+    // rewrites config.json instead:
+    portENTER_CRITICAL(&store_mux);
+    pending_keys |= keys;
+    compact_requested = true;
+    portEXIT_CRITICAL(&store_mux);
+    retry_at = millis() + CONFIG_STORE_RETRY_MS;
+  }
+
+  const char *takeError() {
+    const char *code;
+
+    portENTER_CRITICAL(&store_mux);
+    code = error;
+    error = nullptr;
+    portEXIT_CRITICAL(&store_mux);
+
+    return code;
+  }
+
+  void printStatus(String &out) {
+    out += "Booted from: " + String(booted_from_cache ? "flash" : "SD card") + "\n";
+    out += "Flash cache: " + String(cache_valid ? "valid" : "none") + ", " + String(cache_writes) + " writes\n";
+    out += "SD card: " + String(card ? "yes" : "no") + "\n";
+    out += "Journal: " + String(journal_entries) + " of " + String(CONFIG_JOURNAL_MAX_ENTRIES) + " entries\n";
+    out += "Written: " + String(entries_written) + " entries, " + String(compactions) + " compactions\n";
+    out += "Failures: " + String(failures) + "\n";
+    out += "Last write: " + String(last_write_us) + " us\n";
+  }
+}
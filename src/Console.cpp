@@ -2,6 +2,15 @@
 #include "../include/Hardware.h"
 #include "../include/SDHelper.h"
 #include "../include/Page.h"
+#include "../include/Sampler.h"
+#include "../include/AdcCapture.h"
+#include "../include/OrgasmControl.h"
+#include "../include/AutoCalibration.h"
+#include "../include/MotorOutput.h"
+#include "../include/AccessoryLink.h"
+#include "../include/ConfigStore.h"
+#include "../include/Boot.h"
+#include "../include/WiFiHelper.h"
 #include "../config.h"
 
 #include <SD.h>
@@ -79,8 +88,40 @@ namespace Console {
       {
         .cmd = "mode",
         .alias = "m",
-        .help = "Set mode automatic|manual",
-        .func = cmd_f { RunGraphPage.setMode(args[0]); }
+        .help = "Set mode automatic|manual, arousal detector or motor pattern",
+        .func = cmd_f {
+          if (args[0] == NULL) {
+            ArousalDetectors::printStats(out, OrgasmControl::getDetector());
+
+            out += "Motor patterns:";
+            for (size_t i = 0; i < MotorPatterns::count(); i++) {
+              const MotorPattern *pattern = MotorPatterns::get(i);
+              out += String(pattern == OrgasmControl::getPattern() ? " *" : " ") + pattern->name;
+            }
+            out += "\n";
+          } else if (ArousalDetectors::find(args[0]) != nullptr) {
+            strlcpy(Config.arousal_detector, args[0], sizeof(Config.arousal_detector));
+            OrgasmControl::configChanged();
+            saveConfigToSd(millis() + 300);
+            out += "Arousal detector: " + String(args[0]) + "\n";
+          } else {
+            RunGraphPage.setMode(args[0]);
+          }
+        }
+      },
+      {
+        .cmd = "calibrate",
+        .alias = "C",
+        .help = "Auto-calibrate sensitivity start|stop, or show progress",
+        .func = cmd_f {
+          if (args[0] != NULL && !strcmp(args[0], "start")) {
+            AutoCalibration::start();
+          } else if (args[0] != NULL && !strcmp(args[0], "stop")) {
+            AutoCalibration::stop();
+          }
+
+          AutoCalibration::printStatus(out);
+        }
       },
       {
         .cmd = ".setser",
@@ -110,6 +151,93 @@ namespace Console {
           out += Hardware::getPressureSensitivity();
         },
       },
+      {
+        .cmd = ".sampler",
+        .alias = nullptr,
+        .help = nullptr,
+        .func = cmd_f {
+          if (args[0] != NULL && !strcmp(args[0], "reset")) {
+            Sampler::resetStats();
+            out += "Sampler stats reset.\n";
+          } else {
+            Sampler::printStats(out);
+          }
+        }
+      },
+      {
+        .cmd = ".capture",
+        .alias = nullptr,
+        .help = nullptr,
+        .func = cmd_f {
+          AdcCapture::printStats(out);
+        }
+      },
+      {
+        .cmd = ".motor",
+        .alias = nullptr,
+        .help = nullptr,
+        .func = cmd_f {
+          MotorOutput::printStatus(out);
+        }
+      },
+      {
+        .cmd = ".accessory",
+        .alias = nullptr,
+        .help = nullptr,
+        .func = cmd_f {
+          if (args[0] != NULL && !strcmp(args[0], "reset")) {
+            AccessoryLink::resetStats();
+            out += "Accessory link stats reset.\n";
+          } else if (args[0] != NULL && !strcmp(args[0], "scan")) {
+            AccessoryLink::scan();
+            out += AccessoryLink::isActive() ? "Scanning for accessories.\n" : "Enable the external bus first.\n";
+          } else {
+            AccessoryLink::printStats(out);
+          }
+        }
+      },
+      {
+        .cmd = ".config",
+        .alias = nullptr,
+        .help = nullptr,
+        .func = cmd_f {
+          if (args[0] != NULL && !strcmp(args[0], "compact")) {
+            ConfigStore::compactSoon();
+            out += "Config will be rewritten shortly.\n";
+          } else {
+            ConfigStore::printStatus(out);
+          }
+        }
+      },
+      {
+        .cmd = ".boot",
+        .alias = nullptr,
+        .help = nullptr,
+        .func = cmd_f {
+          Boot::printReport(out);
+        }
+      },
+      {
+        .cmd = ".wifi",
+        .alias = nullptr,
+        .help = nullptr,
+        .func = cmd_f {
+          WiFiHelper::printStatus(out);
+        }
+      },
+      {
+        .cmd = ".frames",
+        .alias = nullptr,
+        .help = nullptr,
+        .func = cmd_f {
+          if (args[0] != NULL && !strcmp(args[0], "reset")) {
+            Page::ResetFrameStats();
+            out += "Frame stats reset.\n";
+          } else {
+            Page::PrintFrameStats(out);
+          }
+        }
+      },
       {
         .cmd = ".getver",
         .alias = nullptr,
@@ -143,9 +271,15 @@ namespace Console {
         Hardware::disableExternalBus();
         out += "External bus disabled.\n";
       } else if (! strcmp(args[0], "slave")) {
+        long address = args[1] != NULL ? strtol(args[1], NULL, 0) : I2C_SLAVE_ADDR;
+        if (address < ACCESSORY_SCAN_FIRST || address > ACCESSORY_SCAN_LAST || address == ACCESSORY_DIGIPOT_ADDR) {
+          out += "Invalid address!\n";
+          return 1;
+        }
+
         Hardware::enableExternalBus();
-        Hardware::joinI2c(I2C_SLAVE_ADDR);
-        out += "Joined external bus as slave.\n";
+        Hardware::joinI2c(address);
+        out += "Joined external bus as slave at 0x" + String(address, HEX) + ".\n";
       } else {
         out += "Unknown subcommand!\n";
         return 1;
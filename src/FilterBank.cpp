@@ -0,0 +1,168 @@
+#include "../include/FilterBank.h"
+
+// A boxcar of N samples is down 3dB at about 0.443 / N of the sample rate.
+#define BOXCAR_CUTOFF 0.443f
+
+static const char *stage_names[FILTER_STAGES] = {
+  "boxcar",
+  "ema",
+  "median",
+  "lowpass"
+};
+
+FilterBank::FilterBank() {
+  updateCoefficients();
+}
+
+void FilterBank::addValue(long value) {
+  int16_t sample = constrain(value, INT16_MIN, INT16_MAX);
+
+  if (filled == 0) {
+    prime(sample);
+  }
+
+  // Read what falls out of the boxcar before it can be overwritten:
+  int16_t leaving = history[head + FILTER_HISTORY - window];
+
+  history[head] = sample;
+  history[head + FILTER_HISTORY] = sample;
+  head = (head + 1) % FILTER_HISTORY;
+  if (filled < FILTER_HISTORY) filled++;
+
+  // Boxcar
+  box_sum += sample - leaving;
+  outputs[FilterBoxcar] = (box_sum + (int32_t)(window / 2)) / (int32_t) window;
+
+  // Exponential
+  int32_t x = (int32_t) sample << 16;
+  ema += (int32_t)(((int64_t)(x - ema) * ema_alpha) >> 16);
+  outputs[FilterEma] = (ema + 0x8000) >> 16;
+
+  // Median
+  outputs[FilterMedian] = median();
+
+  // Biquad low-pass
+  int64_t acc = (int64_t) b0 * x + (int64_t) b1 * x1 + (int64_t) b2 * x2
+              - (int64_t) a1 * y1 - (int64_t) a2 * y2;
+  int32_t y = (int32_t)(acc >> 30);
+  x2 = x1;
+  x1 = x;
+  y2 = y1;
+  y1 = y;
+  outputs[FilterLowPass] = (y + 0x8000) >> 16;
+}
+
+void FilterBank::reset() {
+  filled = 0;
+}
+
+long FilterBank::getAverage() {
+  return outputs[output];
+}
+
+long FilterBank::get(FilterStage stage) {
+  return stage < FILTER_STAGES ? outputs[stage] : 0;
+}
+
+/**
+ * Takes effect on the next sample. The boxcar sum is rebuilt from history,
+ * so a new window averages real samples, same as if it had always been set.
+ */
+void FilterBank::setWindow(size_t new_window) {
+  new_window = constrain(new_window, (size_t) 1, (size_t) FILTER_HISTORY);
+  if (new_window == window) {
+    return;
+  }
+
+  window = new_window;
+  updateCoefficients();
+
+  if (filled == 0) {
+    return;
+  }
+
+  const int16_t *samples = newest(window);
+  int32_t sum = 0;
+  for (size_t i = 0; i < window; i++) {
+    sum += samples[i];
+  }
+
+  box_sum = sum;
+}
+
+const char *FilterBank::getStageName(FilterStage stage) {
+  return stage < FILTER_STAGES ? stage_names[stage] : "";
+}
+
+bool FilterBank::findStage(const char *name, FilterStage &stage) {
+  for (int i = 0; i < FILTER_STAGES; i++) {
+    if (!strcmp(stage_names[i], name)) {
+      stage = (FilterStage) i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Private
+
+/**
+ * The newest `count` samples, oldest first, as one contiguous run.
+ */
+const int16_t *FilterBank::newest(size_t count) {
+  return &history[head + FILTER_HISTORY - count];
+}
+
+/**
+ * Starts every stage settled at the first sample, instead of ramping up
+ * from zero.
+ */
+void FilterBank::prime(int16_t value) {
+  for (size_t i = 0; i < FILTER_HISTORY * 2; i++) {
+    history[i] = value;
+  }
+
+  box_sum = (int32_t) value * window;
+  ema = (int32_t) value << 16;
+  x1 = x2 = y1 = y2 = (int32_t) value << 16;
+}
+
+void FilterBank::updateCoefficients() {
+  // EMA with the same mean delay as the boxcar:
+  ema_alpha = (int32_t)(65536.0f * 2.0f / (window + 1));
+
+  // RBJ cookbook low-pass, Q = 1/sqrt(2):
+  float w0 = 2.0f * PI * min(BOXCAR_CUTOFF / window, 0.45f);
+  float cosw = cos(w0);
+  float alpha = sin(w0) / (2.0f * 0.70710678f);
+  float a0 = 1.0f + alpha;
+  const float q30 = 1073741824.0f;
+
+  b0 = (int32_t)(q30 * ((1.0f - cosw) / 2.0f) / a0);
+  b1 = (int32_t)(q30 * (1.0f - cosw) / a0);
+  b2 = b0;
+  a1 = (int32_t)(q30 * (-2.0f * cosw) / a0);
+  a2 = (int32_t)(q30 * (1.0f - alpha) / a0);
+}
+
+long FilterBank::median() {
+  size_t n = min(window, (size_t) FILTER_MEDIAN_MAX);
+  if ((n & 1) == 0) n--;
+
+  int16_t sorted[FILTER_MEDIAN_MAX];
+  memcpy(sorted, newest(n), n * sizeof(int16_t));
+
+  // Insertion sort, n is small:
+  for (size_t i = 1; i < n; i++) {
+    int16_t v = sorted[i];
+    size_t j = i;
+    while (j > 0 && sorted[j - 1] > v) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = v;
+  }
+
+  return sorted[n / 2];
+}
@@ -1,5 +1,9 @@
 #include "../include/Hardware.h"
 #include "../include/OrgasmControl.h"
+#include "../include/Oversampler.h"
+#include "../include/MotorOutput.h"
+#include "../include/AccessoryLink.h"
+#include "../include/AdcCapture.h"
 
 #include <WireSlave.h>
 #include <EEPROM.h>
@@ -24,8 +28,13 @@ namespace Hardware {
 #endif
 
     Wire.begin();
+    AccessoryLink::begin();
     setPressureSensitivity(Config.sensor_sensitivity);
 
+    if (!MotorOutput::begin()) {
+      Serial.println("Motor output will step without slew limiting.");
+    }
+
     return true;
   }
 
@@ -57,15 +66,14 @@ namespace Hardware {
 
       if (do_dim || do_off) {
         if ((!idle && do_dim) || (!standby && do_off)) {
-          UI.display->dim(true);
+          UI.dim(true);
 
           if (do_off) {
             UI.fadeTo();
             UI.displayOff();
             UI.clear(false);
-            // This calls display instead of render because here
-            // render is disabled.
-            UI.display->display();
+            // Forced, because render is disabled here.
+            UI.render(true);
             standby = true;
           }
 
@@ -73,7 +81,7 @@ namespace Hardware {
         }
       } else {
         if (idle || standby) {
-          UI.display->dim(false);
+          UI.dim(false);
           UI.displayOn();
           UI.render();
           idle = false;
@@ -101,6 +109,7 @@ namespace Hardware {
     digitalWrite(BUS_EN_PIN, HIGH);
     digitalWrite(RJ_LED_1_PIN, HIGH);
     external_connected = true;
+    AccessoryLink::setActive(i2c_slave_addr == 0);
 #endif
   }
 
@@ -109,6 +118,7 @@ namespace Hardware {
     digitalWrite(BUS_EN_PIN, LOW);
     digitalWrite(RJ_LED_1_PIN, LOW);
     external_connected = false;
+    AccessoryLink::setActive(false);
 
     if (i2c_slave_addr > 0) {
       leaveI2c();
@@ -166,25 +176,10 @@ namespace Hardware {
     if (new_speed == motor_speed) return;
 
     motor_speed = new_speed;
-    analogWrite(MOT_PWM_PIN, motor_speed);
-
-    if (external_connected && i2c_slave_addr == 0) {
-      Serial.println("Sending data to I2C remote...");
-
-      WirePacker packer;
-
-      packer.write(0x10);
-      packer.write(motor_speed);
-      packer.end();
+    MotorOutput::setSpeed(motor_speed);
 
-#ifdef I2C_SLAVE_ADDR
-      Wire.beginTransmission(I2C_SLAVE_ADDR);
-#endif
-      while (packer.available()) {    // write every packet byte
-        Wire.write(packer.read());
-      }
-      Wire.endTransmission();
-    }
+    // Only goes anywhere while we're master on the external bus:
+    AccessoryLink::sendSpeed(motor_speed);
   }
 
   void changeMotorSpeed(int diff) {
@@ -207,29 +202,46 @@ namespace Hardware {
   }
 
   long getPressure() {
-    return analogRead(BUTT_PIN);
+    // ADC1 belongs to I2S while capture runs; reading it would stall the stream:
+    if (AdcCapture::running()) {
+      return OrgasmControl::getLastPressure();
+    }
+
+    return Oversampler::read(BUTT_PIN, Config.pressure_oversampling);
   }
 
   void setPressureSensitivity(byte value) {
+    if (!AccessoryLink::takeBus()) {
+      Serial.println("I2C bus busy, sensitivity not set.");
+      return;
+    }
+
     Wire.beginTransmission(0x2F);
     Wire.write((byte)(255 - value) / 2);
     Wire.endTransmission();
+    AccessoryLink::giveBus();
   }
 
   byte getPressureSensitivity() {
+    if (!AccessoryLink::takeBus()) {
+      return Config.sensor_sensitivity;
+    }
+
     Wire.requestFrom(0x2F, 1);
     int val = 0;
     while (Wire.available()) {
       val = Wire.read();
     }
+    AccessoryLink::giveBus();
     return (byte)(127 - val) * 2;
   }
 
   void joinI2c(byte address) {
 #ifdef I2C_SLAVE_ADDR
     i2c_slave_addr = address;
+    AccessoryLink::setActive(false);
     digitalWrite(RJ_LED_2_PIN, HIGH);
-    bool success = WireSlave1.begin(SDA_PIN, SCL_PIN, I2C_SLAVE_ADDR);
+    bool success = WireSlave1.begin(SDA_PIN, SCL_PIN, address);
     if (!success) {
       Serial.println("I2C slave init failed");
       return;
@@ -243,25 +255,34 @@ namespace Hardware {
 #ifdef RJ_LED_2_PIN
     i2c_slave_addr = 0;
     digitalWrite(RJ_LED_2_PIN, LOW);
+    AccessoryLink::setActive(external_connected);
 #endif
   }
 
+  /**
+   * Takes a frame from the master: opcodes back to back, each followed by its
+   * arguments. See AccessoryLink.h.
+   */
   void handleI2c(int avail) {
 #ifdef RJ_LED_2_PIN
     digitalWrite(RJ_LED_2_PIN, LOW);
-    Serial.println("Incoming!");
     byte msg[32] = {0};
-    int i = 0;
-    while (WireSlave1.available()) {
-      msg[i++] = WireSlave1.read();
+    int len = 0;
+    while (WireSlave1.available() && len < (int) sizeof(msg)) {
+      msg[len++] = WireSlave1.read();
     }
 
-    if (i > 0) {
-      switch(msg[0]) {
-        case 0x10:
-          // Motor Speed
-          Hardware::setMotorSpeed(msg[1]);
-          break;
+    int i = 0;
+    while (i < len) {
+      byte op = msg[i++];
+      if (op == ACCESSORY_OP_MOTOR_SPEED && i + 1 <= len) {
+        Hardware::setMotorSpeed(msg[i]);
+        i += 1;
+      } else if (op == ACCESSORY_OP_READINGS && i + 4 <= len) {
+        // The master's pressure and arousal; nothing uses them here yet.
+        i += 4;
+      } else {
+        break;
       }
     }
     digitalWrite(RJ_LED_2_PIN, HIGH);
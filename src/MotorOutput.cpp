@@ -0,0 +1,262 @@
+#include "../include/MotorOutput.h"
+
+// Steepness of the exponential profile: e^-k is what's left at the end.
+#define EXPONENTIAL_K 4.0f
+
+// Transition phase, Q16.
+#define PHASE_DONE 65536
+
+static const char *profile_names[MOTOR_PROFILES] = {
+  "linear",
+  "scurve",
+  "exp"
+};
+
+namespace MotorOutput {
+  namespace {
+    esp_timer_handle_t timer = nullptr;
+    portMUX_TYPE transition_mux = portMUX_INITIALIZER_UNLOCKED;
+
+    uint32_t pwm_hz = 0;
+    uint8_t resolution_bits = 0;
+    uint32_t max_duty = 0;
+
+    // Q16, 0 - 65535, one more entry than segments for interpolation.
+    uint16_t profile_table[MOTOR_PROFILE_SIZE + 1] = {0};
+    MotorProfile profile = MotorProfileSCurve;
+    uint32_t full_scale_steps = 0;
+
+    // Transition, guarded by transition_mux
+    uint32_t target_speed = 0;
+    uint32_t from_duty = 0;
+    uint32_t to_duty = 0;
+    uint32_t duty = 0;
+    uint32_t phase = PHASE_DONE;
+    uint32_t phase_step = 0;
+
+    /**
+     * Runs in the esp_timer task, MOTOR_SLEW_HZ times a second. Integer
+     * only: one table lookup, one interpolation.
+     */
+    void onTimer(void*) {
+      uint32_t next;
+
+      portENTER_CRITICAL(&transition_mux);
+      if (phase >= PHASE_DONE) {
+        portEXIT_CRITICAL(&transition_mux);
+        return;
+      }
+
+      phase = min(phase + phase_step, (uint32_t) PHASE_DONE);
+
+      if (phase >= PHASE_DONE) {
+        next = to_duty;
+      } else {
+        uint32_t index = phase >> 8;
+        uint32_t frac = phase & 0xFF;
+        int32_t a = profile_table[index];
+        int32_t b = profile_table[index + 1];
+        int32_t shape = a + (((b - a) * (int32_t) frac) >> 8);
+
+        next = from_duty + (((int64_t) to_duty - from_duty) * shape >> 16);
+      }
+
+      bool changed = next != duty;
+      duty = next;
+      portEXIT_CRITICAL(&transition_mux);
+
+      if (changed) {
+        ledcWrite(MOT_PWM_CHANNEL, next);
+      }
+    }
+
+    /**
+     * (Re)configures the LEDC channel for motor_pwm_hz, at the finest
+     * resolution the frequency leaves room for.
+     */
+    void setupPwm() {
+      uint32_t max_hz = MOTOR_PWM_CLOCK_HZ >> MOTOR_PWM_MIN_BITS;
+      uint32_t hz = constrain((uint32_t) max(Config.motor_pwm_hz, 1), (uint32_t) 1, max_hz);
+      if (hz == pwm_hz) {
+        return;
+      }
+
+      uint8_t bits = MOTOR_PWM_MIN_BITS;
+      while (bits < MOTOR_PWM_MAX_BITS && ((uint32_t) MOTOR_PWM_CLOCK_HZ >> (bits + 1)) >= hz) {
+        bits++;
+      }
+
+      if (ledcSetup(MOT_PWM_CHANNEL, hz, bits) == 0) {
+        Serial.println("Failed to set up motor PWM at " + String(hz) + " Hz!");
+        return;
+      }
+
+      ledcAttachPin(MOT_PWM_PIN, MOT_PWM_CHANNEL);
+
+      // Rescale what's running to the new resolution, and land there now:
+      uint32_t new_max = (1 << bits) - 1;
+
+      portENTER_CRITICAL(&transition_mux);
+      pwm_hz = hz;
+      resolution_bits = bits;
+      max_duty = new_max;
+      to_duty = target_speed * new_max / 255;
+      duty = to_duty;
+      from_duty = to_duty;
+      phase = PHASE_DONE;
+      portEXIT_CRITICAL(&transition_mux);
+
+      ledcWrite(MOT_PWM_CHANNEL, duty);
+    }
+
+    /**
+     * Tabulates the profile curve over 0..1, in Q16. Float is fine here,
+     * this only runs when the config changes.
+     */
+    void buildProfile(MotorProfile shape) {
+      for (int i = 0; i <= MOTOR_PROFILE_SIZE; i++) {
+        float t = (float) i / MOTOR_PROFILE_SIZE;
+        float y;
+
+        switch (shape) {
+          case MotorProfileSCurve:
+            y = t * t * (3.0f - 2.0f * t);
+            break;
+          case MotorProfileExponential:
+            y = (1.0f - exp(-EXPONENTIAL_K * t)) / (1.0f - exp(-EXPONENTIAL_K));
+            break;
+          case MotorProfileLinear:
+          default:
+            y = t;
+            break;
+        }
+
+        profile_table[i] = constrain((long)(y * 65535.0f + 0.5f), 0L, 65535L);
+      }
+
+      profile = shape;
+    }
+  }
+
+  bool begin() {
+    if (timer != nullptr) {
+      return true;
+    }
+
+    configChanged();
+
+    esp_timer_create_args_t args = {
+      .callback = &onTimer,
+      .arg = nullptr,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "motor"
+    };
+
+    if (esp_timer_create(&args, &timer) != ESP_OK) {
+      Serial.println("Failed to create motor slew timer!");
+      timer = nullptr;
+      return false;
+    }
+
+    esp_timer_start_periodic(timer, 1000000 / MOTOR_SLEW_HZ);
+    return true;
+  }
+
+  void end() {
+    if (timer != nullptr) {
+      esp_timer_stop(timer);
+      esp_timer_delete(timer);
+      timer = nullptr;
+    }
+
+    ledcWrite(MOT_PWM_CHANNEL, 0);
+  }
+
+  void configChanged() {
+    setupPwm();
+
+    MotorProfile shape = MotorProfileSCurve;
+    if (!findProfile(Config.motor_profile, shape)) {
+      Serial.println("Unknown motor profile: " + String(Config.motor_profile));
+    }
+
+    // Nothing reads the table outside a transition, so finish the current
+    // one before it changes under it:
+    portENTER_CRITICAL(&transition_mux);
+    phase = PHASE_DONE;
+    duty = to_duty;
+    portEXIT_CRITICAL(&transition_mux);
+    ledcWrite(MOT_PWM_CHANNEL, to_duty);
+
+    buildProfile(shape);
+    full_scale_steps = (uint32_t) max(Config.motor_slew_ms, 0) * MOTOR_SLEW_HZ / 1000;
+  }
+
+  /**
+   * Starts a transition to `speed`, from wherever the output is now. It takes
+   * motor_slew_ms scaled by how far it has to go. A stop is the exception:
+   * a denial or the STOP button cuts the motor on the spot.
+   */
+  void setSpeed(byte speed) {
+    bool immediate;
+
+    portENTER_CRITICAL(&transition_mux);
+    target_speed = speed;
+    uint32_t target = (uint32_t) speed * max_duty / 255;
+
+    if (target == to_duty) {
+      portEXIT_CRITICAL(&transition_mux);
+      return;
+    }
+
+    uint32_t distance = target > duty ? target - duty : duty - target;
+    uint32_t steps = max_duty > 0 ? full_scale_steps * distance / max_duty : 0;
+
+    from_duty = duty;
+    to_duty = target;
+    immediate = steps == 0 || timer == nullptr || target == 0;
+
+    if (immediate) {
+      duty = target;
+      phase = PHASE_DONE;
+    } else {
+      phase = 0;
+      phase_step = max((uint32_t) PHASE_DONE / steps, (uint32_t) 1);
+    }
+    portEXIT_CRITICAL(&transition_mux);
+
+    if (immediate) {
+      ledcWrite(MOT_PWM_CHANNEL, target);
+    }
+  }
+
+  uint32_t getDuty() {
+    return duty;
+  }
+
+  uint32_t getMaxDuty() {
+    return max_duty;
+  }
+
+  const char *getProfileName(MotorProfile shape) {
+    return shape < MOTOR_PROFILES ? profile_names[shape] : "";
+  }
+
+  bool findProfile(const char *name, MotorProfile &shape) {
+    for (int i = 0; i < MOTOR_PROFILES; i++) {
+      if (!strcmp(profile_names[i], name)) {
+        shape = (MotorProfile) i;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void printStatus(String &out) {
+    out += "PWM: " + String(pwm_hz) + " Hz, " + String(resolution_bits) + " bit\n";
+    out += "Duty: " + String(duty) + " -> " + String(to_duty) + " of " + String(max_duty) + "\n";
+    out += "Profile: " + String(getProfileName(profile)) + ", " +
+           String(Config.motor_slew_ms) + " ms full scale\n";
+  }
+}
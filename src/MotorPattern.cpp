@@ -0,0 +1,102 @@
+#include "../include/MotorPattern.h"
+
+// Tables are precomputed, so nothing evaluates a curve at run time. Levels
+// are a fraction of the ramp speed, 255 = all of it.
+static const MotorPattern builtin_patterns[] = {
+  // The plain ramp, unmodulated.
+  { "steady", 1000, 1, false, { 255 } },
+
+  // On / off, 0.6s each.
+  { "pulse", 1200, 2, false, { 255, 0 } },
+
+  // Sine, between 25% and 100%, over 4s.
+  { "wave", 4000, 32, true, {
+      160, 178, 196, 213, 227, 239, 248, 253, 255, 253, 248, 239, 227, 213, 196, 178,
+      160, 141, 123, 106,  92,  80,  71,  66,  64,  66,  71,  80,  92, 106, 123, 141
+  } },
+
+  // Climbs in steps to full over 8s, then drops back.
+  { "climb", 8000, 8, false, { 64, 96, 128, 160, 192, 224, 255, 255 } },
+
+  // A bounded random walk, over 16s.
+  { "random", 16000, 32, true, {
+      164, 140, 152, 192, 152, 112, 136,  96,  96, 120,  96, 120,  96,  96,  96, 108,
+      120,  96,  96,  96, 120, 132,  96, 120,  96,  96, 136, 176, 200, 160, 184, 208
+  } }
+};
+
+#define BUILTIN_PATTERNS (sizeof(builtin_patterns) / sizeof(MotorPattern))
+
+static MotorPattern loaded_patterns[PATTERN_MAX_LOADED];
+static size_t loaded_count = 0;
+
+namespace MotorPatterns {
+  size_t count() {
+    return BUILTIN_PATTERNS + loaded_count;
+  }
+
+  const MotorPattern *get(size_t index) {
+    if (index < BUILTIN_PATTERNS) {
+      return &builtin_patterns[index];
+    }
+
+    index -= BUILTIN_PATTERNS;
+    return index < loaded_count ? &loaded_patterns[index] : nullptr;
+  }
+
+  const MotorPattern *find(const char *name) {
+    for (size_t i = 0; i < count(); i++) {
+      const MotorPattern *pattern = get(i);
+      if (!strcmp(pattern->name, name)) {
+        return pattern;
+      }
+    }
+
+    return nullptr;
+  }
+
+  uint8_t level(const MotorPattern &pattern, uint32_t elapsed_ms) {
+    if (pattern.length <= 1 || pattern.period_ms == 0) {
+      return pattern.steps[0];
+    }
+
+    // Position in the period, in steps * period_ms:
+    uint32_t position = (elapsed_ms % pattern.period_ms) * pattern.length;
+    uint32_t index = position / pattern.period_ms;
+    uint8_t a = pattern.steps[index];
+
+    if (!pattern.interpolate) {
+      return a;
+    }
+
+    uint8_t b = pattern.steps[(index + 1) % pattern.length];
+    int32_t frac = (position % pattern.period_ms) * 256 / pattern.period_ms;
+    return a + (((int32_t) b - a) * frac >> 8);
+  }
+
+  bool add(const MotorPattern &pattern) {
+    if (pattern.length < 1 || pattern.length > PATTERN_MAX_STEPS) {
+      return false;
+    }
+
+    for (size_t i = 0; i < BUILTIN_PATTERNS; i++) {
+      if (!strcmp(builtin_patterns[i].name, pattern.name)) {
+        return false;
+      }
+    }
+
+    for (size_t i = 0; i < loaded_count; i++) {
+      if (!strcmp(loaded_patterns[i].name, pattern.name)) {
+        loaded_patterns[i] = pattern;
+        return true;
+      }
+    }
+
+    if (loaded_count >= PATTERN_MAX_LOADED) {
+      return false;
+    }
+
+    loaded_patterns[loaded_count++] = pattern;
+    return true;
+  }
+}
@@ -0,0 +1,68 @@
+#include "../include/MotorPattern.h"
+
+#include <SD.h>
+#include <ArduinoJson.h>
+
+namespace MotorPatterns {
+  namespace {
+    bool parsePattern(JsonDocument &doc, MotorPattern &pattern) {
+      const char *name = doc["name"] | "";
+      JsonArray steps = doc["steps"];
+
+      if (name[0] == '\0' || steps.isNull() || steps.size() < 1 || steps.size() > PATTERN_MAX_STEPS) {
+        return false;
+      }
+
+      memset(&pattern, 0, sizeof(pattern));
+      strlcpy(pattern.name, name, sizeof(pattern.name));
+      pattern.period_ms = doc["period_ms"] | 1000;
+      pattern.interpolate = doc["interpolate"] | true;
+      pattern.length = steps.size();
+
+      for (size_t i = 0; i < pattern.length; i++) {
+        pattern.steps[i] = constrain(steps[i].as<int>(), 0, 255);
+      }
+
+      return true;
+    }
+  }
+
+  int loadFromSd() {
+    File dir = SD.open(PATTERN_DIR);
+    if (!dir || !dir.isDirectory()) {
+      return 0;
+    }
+
+    int loaded = 0;
+    DynamicJsonDocument doc(1024);
+
+    while (true) {
+      File entry = dir.openNextFile();
+      if (!entry) {
+        break;
+      }
+
+      String name = entry.name();
+      if (entry.isDirectory() || !name.endsWith(".json")) {
+        entry.close();
+        continue;
+      }
+
+      MotorPattern pattern;
+      DeserializationError e = deserializeJson(doc, entry);
+      entry.close();
+
+      if (e || !parsePattern(doc, pattern)) {
+        Serial.println("Invalid motor pattern: " + name);
+      } else if (!add(pattern)) {
+        Serial.println("Couldn't add motor pattern: " + name);
+      } else {
+        loaded++;
+      }
+    }
+
+    dir.close();
+    Serial.println("Loaded " + String(loaded) + " motor patterns.");
+    return loaded;
+  }
+}
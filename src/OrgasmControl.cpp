@@ -1,142 +1,308 @@
 #include "../include/OrgasmControl.h"
 #include "../include/Hardware.h"
-#include "../include/WiFiHelper.h"
+#include "../include/Sampler.h"
+#include "../include/AdcCapture.h"
+#include "../include/SessionRecorder.h"
+#include "../include/AutoCalibration.h"
+#include <atomic>
 
 namespace OrgasmControl {
   namespace {
+    // Set by configChanged() from any task; tick() applies it on the control
+    // loop, so nothing rebuilds filter state under a step.
+    std::atomic<bool> constants_dirty{true};
+
+    // When the polled path takes its next step. Kept in microseconds, so
+    // rates that don't divide 1000 ms still average out to the right one.
+    unsigned long next_update_us = 0;
+
+    FilterBank PressureFilter;
+    BaselineTracker Baseline;
+    TrendPredictor ArousalTrend;
+    Oversampler::Decimator capture_decimator;
+    Reading reading_history[READING_HISTORY_SIZE];
+
     /**
      * Main orgasm detection / edging algorithm happens here.
-     * This happens with a default update frequency of 50Hz.
+     * This happens with a default update frequency of 50Hz. What counts as
+     * arousal is up to the selected ArousalDetector.
      */
-    void updateArousal() {
+    void updateArousal(long pressure) {
       // Decay stale arousal value:
-      arousal *= 0.99;
+      arousal = fixed_mul(arousal, arousal_decay);
 
-      // Acquire new pressure and take average:
-      pressure_value = Hardware::getPressure();
-      PressureAverage.addValue(pressure_value);
-      long p_avg = PressureAverage.getAverage();
+      // Take new pressure average:
+      pressure_value = pressure;
+      PressureFilter.addValue(pressure_value);
+      long p_avg = PressureFilter.getAverage();
       long p_check = Config.use_average_values ? p_avg : pressure_value;
 
-      // Increment arousal:
-      if (p_check < last_value) { // falling edge of peak
-        if (p_check > peak_start) { // first tick past peak?
-          if (p_check - peak_start >= Config.sensitivity_threshold / 10) { // big peak
-            arousal += p_check - peak_start;
-          }
-        }
-        peak_start = p_check;
+      // Detect on pressure above the resting baseline, so slow drift doesn't
+      // stretch or shrink peaks:
+      if (baseline_on) {
+        Baseline.addValue(p_avg);
+        p_check -= Baseline.get();
       }
 
-      last_value = p_check;
+      // Increment arousal:
+      arousal = fixed_add_sat(arousal, detector->update(p_check));
+
+      if (edge_lead_ticks > 0) {
+        ArousalTrend.addValue(arousal);
+      }
     }
 
     void updateMotorSpeed() {
-      // Motor increment goes 0 - 100 in ramp_time_s, in steps of 1/update_fequency
-      float motor_increment = (
-          (float)Config.motor_max_speed /
-          ((float)Config.update_frequency_hz * (float)Config.motor_ramp_time_s)
-      );
+      bool over = arousal > int_to_fixed(Config.sensitivity_threshold);
 
       // Ope, orgasm incoming! Stop it!
-      if (arousal > Config.sensitivity_threshold && motor_speed > 0) {
+      if ((over || edgePredicted()) && motor_speed > 0) {
         // The motor_speed check above, btw, is so we only hit this once per peak.
         // Set the motor speed to 0, but actually set it to a negative number because cooldown delay
-        motor_speed = max(-255.0f, -0.5f *
-          (float)Config.motor_ramp_time_s *
-          (float)Config.update_frequency_hz *
-              motor_increment
-        );
+        motor_speed = motor_cooldown;
 
         denial_count++;
+        if (!over) {
+          predicted_denial_count++;
+        }
 
-      } else if (motor_speed < Config.motor_max_speed) {
-        motor_speed += motor_increment;
-      } else if (motor_speed > Config.motor_max_speed) {
-        motor_speed = Config.motor_max_speed;
+      } else if (motor_speed < motor_max) {
+        motor_speed = min(motor_speed + motor_increment, motor_max);
+      } else if (motor_speed > motor_max) {
+        motor_speed = motor_max;
       }
 
       // Control motor if we are not manually doing so.
       if (control_motor) {
-        Hardware::setMotorSpeed(motor_speed);
+        long speed = fixed_to_int(motor_speed);
+
+        // The pattern shapes the ramp, and never outlasts a denial:
+        if (pattern != nullptr && speed > 0) {
+          speed = speed * MotorPatterns::level(*pattern, last_update_ms - pattern_start_ms) / 255;
+        }
+
+        Hardware::setMotorSpeed(speed);
       }
     }
-  }
 
-  void startRecording() {
-    if (logfile) {
-      stopRecording();
+    /**
+     * Whether arousal is on course to cross the threshold within
+     * edge_lead_ms, going by its recent trend.
+     */
+    bool edgePredicted() {
+      if (edge_lead_ticks <= 0) {
+        return false;
+      }
+
+      fixed_t threshold = int_to_fixed(Config.sensitivity_threshold);
+      if (ArousalTrend.getFitted() < (int64_t) threshold * PREDICT_MIN_PERCENT / 100) {
+        return false;
+      }
+
+      long ticks = ArousalTrend.samplesUntil(threshold);
+      return ticks >= 0 && ticks <= edge_lead_ticks;
     }
 
-    UI.toastNow("Preapring\nrecording...", 0);
+    /**
+     * Precomputes the per-tick constants for updateArousal() and updateMotorSpeed(),
+     * so none of the float math happens per sample.
+     */
+    void updateConstants() {
+      float hz = max(Config.update_frequency_hz, 1);
+
+      // Decay is specified per tick at 50Hz; keep the same half-life in seconds at any rate.
+      arousal_decay = float_to_fixed(pow(AROUSAL_DECAY, (float)AROUSAL_DECAY_HZ / hz));
+
+      // Motor increment goes 0 - 100 in ramp_time_s, in steps of 1/update_fequency
+      motor_max = int_to_fixed(Config.motor_max_speed);
+      if (Config.motor_ramp_time_s > 0) {
+        motor_increment = max(float_to_fixed(
+            (float)Config.motor_max_speed / (hz * (float)Config.motor_ramp_time_s)
+        ), Config.motor_max_speed > 0 ? (fixed_t)1 : (fixed_t)0);
+      } else {
+        motor_increment = motor_max;
+      }
+
+      // Cooldown is half a ramp below zero, so the motor is off for half the ramp time.
+      motor_cooldown = max(int_to_fixed(-255), -(motor_max / 2));
+
+      // Smoothing
+      FilterStage stage = FilterBoxcar;
+      if (!FilterBank::findStage(Config.pressure_filter, stage)) {
+        Serial.println("Unknown pressure filter: " + String(Config.pressure_filter));
+      }
+
+      PressureFilter.setWindow(Config.pressure_smoothing);
+      PressureFilter.setOutput(stage);
+
+      // Predictive edging. The trend is only fed from step(), on this loop:
+      edge_lead_ticks = max(Config.edge_lead_ms, 0) * hz / 1000;
+      ArousalTrend.setWindow((size_t)(PREDICT_WINDOW_MS * hz / 1000));
+      if (edge_lead_ticks == 0) {
+        ArousalTrend.reset();
+      }
+
+      // Latched here, so the tracker only turns on together with its window:
+      baseline_on = Config.baseline_window_s > 0;
+      if (baseline_on) {
+        Baseline.setWindow((size_t)(Config.baseline_window_s * hz));
+      } else {
+        Baseline.reset();
+      }
+
+      selectDetector();
+      selectPattern();
+    }
+
+    /**
+     * Switches to the detector named by Config.arousal_detector, falling back
+     * to the default if there is no such detector. Only from updateConstants(),
+     * on the control loop: the new detector is reset on the core that runs it.
+     */
+    void selectDetector() {
+      ArousalDetector *selected = ArousalDetectors::find(Config.arousal_detector);
+
+      if (selected == nullptr) {
+        Serial.println("Unknown arousal detector: " + String(Config.arousal_detector));
+        selected = ArousalDetectors::get(0);
+      }
+
+      if (selected != detector) {
+        selected->reset();
+        detector = selected;
+      }
+    }
+
+    /**
+     * Picks up Config.motor_pattern, falling back to the plain ramp.
+     */
+    void selectPattern() {
+      const MotorPattern *selected = MotorPatterns::find(Config.motor_pattern);
+
+      if (selected == nullptr) {
+        Serial.println("Unknown motor pattern: " + String(Config.motor_pattern));
+        selected = MotorPatterns::get(0);
+      }
+
+      if (selected != pattern) {
+        pattern = selected;
+        pattern_start_ms = last_update_ms;
+      }
+    }
+
+    /**
+     * One control step for one pressure sample, taken at sample_ms.
+     */
+    void step(long pressure, long sample_ms) {
+      last_update_ms = sample_ms;
+      updateArousal(pressure);
+      updateMotorSpeed();
+      update_flag = true;
+
+      reading.millis = sample_ms;
+      reading.pressure = pressure_value;
+      reading.avg_pressure = PressureFilter.getAverage();
+      reading.arousal = min(getArousal(), (long)UINT16_MAX);
+      reading.motor_speed = Hardware::getMotorSpeed();
+      reading.sensitivity_threshold = Config.sensitivity_threshold;
+      reading.baseline = getBaseline();
+
+      reading_history[reading_count & (READING_HISTORY_SIZE - 1)] = reading;
+      reading_count++;
+
+      SessionRecorder::record(reading);
+      AutoCalibration::update(reading);
 
-    struct tm timeinfo;
-    char filename_date[16];
-    if(!WiFiHelper::connected() || !getLocalTime(&timeinfo)){
-      Serial.println("Failed to obtain time");
-      sprintf(filename_date, "%d", millis());
-    } else {
-      strftime(filename_date, 16, "%Y%m%d-%H%M%S", &timeinfo);
+      // Write to console for classic log mode:
+      if (Config.classic_serial) {
+        Serial.printf("%u,%u,%u,%u,%u\n",
+            reading.pressure,
+            reading.avg_pressure,
+            reading.arousal,
+            reading.motor_speed,
+            reading.sensitivity_threshold);
+      }
     }
 
-    String logfile_name = "/log-" + String(filename_date) + ".csv";
-    Serial.println("Opening logfile: " + logfile_name);
-    logfile = SD.open(logfile_name, FILE_WRITE);
-
-    if (!logfile) {
-      Serial.println("Couldn't open logfile to save!" + String(logfile));
-      UI.toast("Error opening\nlogfile!");
-    } else {
-      recording_start_ms = millis();
-      logfile.println("millis,pressure,avg_pressure,arousal,motor_speed,sensitivity_threshold");
-      UI.drawRecordIcon(1, 1500);
-      UI.toast(String("Recording started:\n" + logfile_name).c_str());
+    /**
+     * Decimates captured samples into control steps, one per
+     * sample_rate / update_frequency_hz samples, stamped with the time of
+     * the step's last sample.
+     */
+    void stepBlock(const SampleBlock *block) {
+      size_t per_step = max(block->sample_rate_hz / max(Config.update_frequency_hz, 1), (uint32_t) 1);
+
+      for (size_t i = 0; i < block->count; i++) {
+        capture_decimator.add(block->samples[i]);
+
+        if (capture_decimator.count() >= per_step) {
+          step(capture_decimator.read(), block->sampleTimeUs(i) / 1000);
+        }
+      }
     }
   }
 
+  void startRecording() {
+    SessionRecorder::start();
+  }
+
   void stopRecording() {
-    if (logfile) {
-      UI.toastNow("Stopping...", 0);
-      Serial.println("Closing logfile.");
-      logfile.close();
-      logfile = File();
-      UI.drawRecordIcon(0);
-      UI.toast("Recording stopped.");
-    }
+    SessionRecorder::stop();
   }
 
   bool isRecording() {
-    return (bool)logfile;
+    return SessionRecorder::isRecording();
   }
 
   void tick() {
-    long update_frequency_ms = (1.0f / Config.update_frequency_hz) * 1000.0f;
+    update_flag = false;
 
-    if (millis() - last_update_ms > update_frequency_ms) {
-      updateArousal();
-      updateMotorSpeed();
-      update_flag = true;
-      last_update_ms = millis();
+    if (constants_dirty.exchange(false)) {
+      updateConstants();
+    }
 
-      // Data for logfile or classic log.
-      String data =
-          String(getLastPressure()) + "," +
-          String(getAveragePressure()) + "," +
-          String(getArousal()) + "," +
-          String(Hardware::getMotorSpeed()) + "," +
-          String(Config.sensitivity_threshold);
+    // Samples captured by DMA, if it is running:
+    if (AdcCapture::running()) {
+      if (capture_consumer < 0) {
+        capture_consumer = AdcCapture::subscribe("control");
+      }
 
-      // Write out to logfile, which includes millis:
-      if (logfile) {
-        logfile.println(String(last_update_ms - recording_start_ms) + "," + data);
+      SampleBlock *block;
+      while (AdcCapture::receive(capture_consumer, block)) {
+        stepBlock(block);
+        AdcCapture::release(block);
       }
 
-      // Write to console for classic log mode:
-      if (Config.classic_serial) {
-        Serial.println(data);
+      return;
+    }
+
+    // Samples taken on the sampler clock, if it is running:
+    if (Sampler::running()) {
+      if (Sampler::getFrequency() != Config.update_frequency_hz) {
+        Sampler::setFrequency(Config.update_frequency_hz);
+      }
+
+      PressureSample sample;
+      while (Sampler::read(sample)) {
+        step(sample.pressure, sample.timestamp_us / 1000);
       }
-    } else {
-      update_flag = false;
+
+      return;
+    }
+
+    // Otherwise, poll on a fixed schedule, so the loop's own time between
+    // ticks doesn't stretch the period:
+    unsigned long now_us = micros();
+    unsigned long period_us = 1000000UL / max(Config.update_frequency_hz, 1);
+
+    if ((long)(now_us - next_update_us) >= 0) {
+      // Skip what was missed rather than step through it all at once:
+      if ((long)(now_us - next_update_us) >= (long) period_us) {
+        next_update_us = now_us;
+      }
+
+      next_update_us += period_us;
+      step(Hardware::getPressure(), millis());
     }
   }
 
@@ -144,16 +310,59 @@ namespace OrgasmControl {
     return update_flag;
   }
 
+  ArousalDetector *getDetector() {
+    return detector;
+  }
+
+  const MotorPattern *getPattern() {
+    return pattern;
+  }
+
   int getDenialCount() {
     return denial_count;
   }
 
+  /**
+   * Denials from edge_lead_ms prediction, before arousal actually crossed
+   * the threshold. Included in getDenialCount().
+   */
+  int getPredictedDenialCount() {
+    return predicted_denial_count;
+  }
+
+  /**
+   * The most recent control step, as recorded and streamed.
+   */
+  const Reading &getReading() {
+    return reading;
+  }
+
+  /**
+   * Total control steps taken since boot. The newest reading is index
+   * getReadingCount() - 1.
+   */
+  uint32_t getReadingCount() {
+    return reading_count;
+  }
+
+  /**
+   * Fetches reading number `index`, if it is still in the history window.
+   */
+  bool getHistoricReading(uint32_t index, Reading &out) {
+    if (reading_count - index > READING_HISTORY_SIZE || index >= reading_count) {
+      return false;
+    }
+
+    out = reading_history[index & (READING_HISTORY_SIZE - 1)];
+    return true;
+  }
+
   /**
    * Returns a normalized motor speed from 0..255
    * @return normalized motor speed byte
    */
   byte getMotorSpeed() {
-    return min((float)floor(max(motor_speed, 0.0f)), 255.0f);
+    return min(fixed_to_int(max(motor_speed, (fixed_t)0)), 255L);
   }
 
   float getMotorSpeedPercent() {
@@ -161,11 +370,11 @@ namespace OrgasmControl {
   }
 
   long getArousal() {
-    return arousal;
+    return fixed_round(arousal);
   }
 
   float getArousalPercent() {
-    return (float)arousal / Config.sensitivity_threshold;
+    return fixed_to_float(arousal) / Config.sensitivity_threshold;
   }
 
   long getLastPressure() {
@@ -173,11 +382,31 @@ namespace OrgasmControl {
   }
 
   long getAveragePressure() {
-    return PressureAverage.getAverage();
+    return PressureFilter.getAverage();
+  }
+
+  /**
+   * Resting pressure subtracted before detection, or 0 if baseline tracking
+   * is off.
+   */
+  long getBaseline() {
+    return baseline_on ? Baseline.get() : 0;
+  }
+
+  void configChanged() {
+    constants_dirty = true;
   }
 
   void controlMotor(bool control) {
+    if (control && !control_motor) {
+      pattern_start_ms = last_update_ms;
+    }
+
     control_motor = control;
+
+    if (control && Config.auto_calibrate && !AutoCalibration::active()) {
+      AutoCalibration::start();
+    }
   }
 
   void pauseControl() {
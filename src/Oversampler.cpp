@@ -0,0 +1,49 @@
+#include "../include/Oversampler.h"
+
+namespace Oversampler {
+  long read(uint8_t pin, size_t count) {
+    if (count <= 1) {
+      return analogRead(pin);
+    }
+
+    uint16_t samples[OVERSAMPLE_MAX];
+    count = min(count, (size_t) OVERSAMPLE_MAX);
+
+    for (size_t i = 0; i < count; i++) {
+      samples[i] = analogRead(pin);
+    }
+
+    return decimate(samples, count);
+  }
+
+  long decimate(const uint16_t *samples, size_t count) {
+    Decimator decimator;
+
+    for (size_t i = 0; i < count; i++) {
+      decimator.add(samples[i]);
+    }
+
+    return decimator.read();
+  }
+
+  long Decimator::read() {
+    if (n == 0) {
+      return 0;
+    }
+
+    uint32_t total = sum;
+    size_t used = n;
+
+    if (n >= OVERSAMPLE_TRIM_MIN) {
+      total -= lo + hi;
+      used -= 2;
+    }
+
+    sum = 0;
+    lo = UINT16_MAX;
+    hi = 0;
+    n = 0;
+
+    return (total + used / 2) / used;
+  }
+}
@@ -6,6 +6,10 @@ Page* Page::previousPage = nullptr;
 Page* Page::previousPages[HISTORY_LENGTH] = { nullptr };
 size_t Page::historyIndex = 0;
 
+bool Page::renderPending = false;
+long Page::lastFrameMs = 0;
+FrameStats Page::frameStats = {0};
+
 void Page::Go(Page* page, bool saveHistory) {
   // Close Menus & toasts
   UI.openMenu(nullptr, false, false);
@@ -27,7 +31,7 @@ void Page::Go(Page* page, bool saveHistory) {
 
   currentPage = page;
   currentPage->Enter();
-  Rerender();
+  RenderNow();
 }
 
 void Page::GoBack() {
@@ -40,11 +44,32 @@ void Page::GoBack() {
 void Page::Reenter() {
   if (currentPage != nullptr) {
     currentPage->Enter(false);
-    Rerender();
+    RenderNow();
   }
 }
 
+/**
+ * Marks the page as needing a new frame. Any number of calls between two
+ * frames collapse into one render, which DoLoop() paces to screen_max_fps,
+ * so the control rate no longer sets the display rate.
+ */
 void Page::Rerender() {
+  frameStats.invalidations++;
+
+  if (renderPending) {
+    frameStats.coalesced++;
+  }
+
+  renderPending = true;
+}
+
+/**
+ * Renders a frame right away, skipping the frame governor. Used when
+ * navigating, so a new page never shows a stale frame.
+ */
+void Page::RenderNow() {
+  renderPending = false;
+
   // Skip rendering the page IFF a menu is open.
   // We could technically still render and the menu should write over it but,
   // that's wasted ticks, and Render() should not assume to ever be called on
@@ -53,6 +78,9 @@ void Page::Rerender() {
     return;
   }
 
+  long start_us = micros();
+  lastFrameMs = millis();
+
   UI.clear(false);
 
   if (currentPage != nullptr) {
@@ -61,11 +89,51 @@ void Page::Rerender() {
 
   UI.drawToast();
   UI.render();
+
+  uint32_t render_us = micros() - start_us;
+  frameStats.frames++;
+  frameStats.last_render_us = render_us;
+  frameStats.total_render_us += render_us;
+  if (render_us > frameStats.max_render_us) {
+    frameStats.max_render_us = render_us;
+  }
 }
 
 void Page::DoLoop() {
   if (currentPage != nullptr)
     currentPage->Loop();
+
+  if (!renderPending)
+    return;
+
+  long frame_ms = Config.screen_max_fps > 0 ? 1000 / Config.screen_max_fps : 0;
+  if (millis() - lastFrameMs >= frame_ms) {
+    RenderNow();
+  }
+}
+
+void Page::GetFrameStats(FrameStats &stats) {
+  stats = frameStats;
+}
+
+void Page::ResetFrameStats() {
+  frameStats = FrameStats();
+}
+
+void Page::PrintFrameStats(String &out) {
+  FrameStats s = frameStats;
+
+  out += "Max FPS: ";
+  out += Config.screen_max_fps > 0 ? String(Config.screen_max_fps) : String("unlimited");
+  out += "\n";
+  out += "Frames: " + String(s.frames) + ", invalidations: " + String(s.invalidations) +
+         ", coalesced: " + String(s.coalesced) + "\n";
+
+  if (s.frames > 0) {
+    out += "Render: last " + String(s.last_render_us) + " us, mean " +
+           String((uint32_t)(s.total_render_us / s.frames)) + " us, max " +
+           String(s.max_render_us) + " us\n";
+  }
 }
 
 // Instance Methods:
@@ -0,0 +1,112 @@
+#include "../include/PartialSSD1306.h"
+
+// Conservative I2C chunk size, the ESP32 Wire buffer is larger.
+#define PARTIAL_WIRE_MAX 32
+
+PartialSSD1306::~PartialSSD1306() {
+  free(shadow);
+}
+
+void PartialSSD1306::displayFull(void) {
+  Adafruit_SSD1306::display();
+
+  if (shadow != nullptr) {
+    memcpy(shadow, getBuffer(), WIDTH * ((HEIGHT + 7) / 8));
+    shadow_valid = true;
+  }
+
+  last_transfer_bytes = WIDTH * ((HEIGHT + 7) / 8);
+  total_transfer_bytes += last_transfer_bytes;
+}
+
+void PartialSSD1306::display(void) {
+  display(getBuffer());
+}
+
+void PartialSSD1306::display(const uint8_t *frame) {
+  const uint16_t pages = (HEIGHT + 7) / 8;
+
+  if (shadow == nullptr) {
+    shadow = (uint8_t*) malloc(WIDTH * pages);
+  }
+
+  // Bit-banged SPI, only the base class knows how to talk to it:
+  if (!hasBus()) {
+    displayFull();
+    return;
+  }
+
+  // Without a trusted shadow every page goes out whole:
+  bool diff = shadow != nullptr && shadow_valid;
+  last_transfer_bytes = 0;
+
+  for (uint8_t page = 0; page < pages; page++) {
+    const uint8_t *row = &frame[page * WIDTH];
+    int16_t first = 0;
+    int16_t last = WIDTH - 1;
+
+    if (diff) {
+      const uint8_t *shadow_row = &shadow[page * WIDTH];
+
+      while (first < WIDTH && row[first] == shadow_row[first]) first++;
+      if (first == WIDTH) continue;
+
+      while (last > first && row[last] == shadow_row[last]) last--;
+    }
+
+    sendRange(page, first, last, &row[first]);
+    if (shadow != nullptr) {
+      memcpy(&shadow[page * WIDTH + first], &row[first], last - first + 1);
+    }
+    last_transfer_bytes += last - first + 1;
+  }
+
+  shadow_valid = shadow != nullptr;
+  total_transfer_bytes += last_transfer_bytes;
+}
+
+/**
+ * Sets the panel's write window to one page, columns first_col..last_col, and
+ * streams the data into it. Mirrors the bus handling in Adafruit_SSD1306::display().
+ */
+void PartialSSD1306::sendRange(uint8_t page, uint8_t first_col, uint8_t last_col, const uint8_t *data) {
+  const uint8_t window[] = {
+    SSD1306_PAGEADDR, page, page,
+    SSD1306_COLUMNADDR, first_col, last_col
+  };
+  uint16_t count = last_col - first_col + 1;
+
+  if (wire) {
+#if ARDUINO >= 157
+    wire->setClock(wireClk);
+#endif
+    ssd1306_commandList(window, sizeof(window));
+
+    while (count > 0) {
+      uint16_t chunk = min(count, (uint16_t)(PARTIAL_WIRE_MAX - 1));
+      wire->beginTransmission(i2caddr);
+      wire->write((uint8_t)0x40);
+      wire->write(data, chunk);
+      wire->endTransmission();
+      data += chunk;
+      count -= chunk;
+    }
+#if ARDUINO >= 157
+    wire->setClock(restoreClk);
+#endif
+  } else {
+#if defined(SPI_HAS_TRANSACTION)
+    spi->beginTransaction(spiSettings);
+#endif
+    digitalWrite(csPin, LOW);
+    ssd1306_commandList(window, sizeof(window));
+
+    digitalWrite(dcPin, HIGH);
+    spi->writeBytes(data, count);
+
+    digitalWrite(csPin, HIGH);
+#if defined(SPI_HAS_TRANSACTION)
+    spi->endTransaction();
+#endif
+  }
+}
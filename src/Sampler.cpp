@@ -0,0 +1,171 @@
+#include "../include/Sampler.h"
+#include "../include/Hardware.h"
+#include "../include/SampleBuffer.h"
+#include <esp_timer.h>
+
+namespace Sampler {
+  namespace {
+    esp_timer_handle_t timer = nullptr;
+    TaskHandle_t task = nullptr;
+    int frequency_hz = 0;
+    int64_t last_sample_us = 0;
+
+    SampleBuffer<PressureSample, SAMPLER_BUFFER_SIZE> buffer;
+    SamplerStats stats = {0};
+
+    void onTimer(void*);
+    void samplerTask(void*);
+  }
+
+  bool begin(int hz) {
+    if (timer != nullptr) {
+      setFrequency(hz);
+      return true;
+    }
+
+    BaseType_t created = xTaskCreatePinnedToCore(
+        samplerTask,              /* Task function. */
+        "sampler",                /* name of task. */
+        2048,                     /* Stack size of task */
+        NULL,                     /* parameter of the task */
+        configMAX_PRIORITIES - 2, /* priority of the task */
+        &task,                    /* Task handle to keep track of created task */
+        0);                       /* pin task to core 0 */
+
+    if (created != pdPASS) {
+      Serial.println("Failed to start sampler task!");
+      task = nullptr;
+      return false;
+    }
+
+    esp_timer_create_args_t args = {
+      .callback = &onTimer,
+      .arg = nullptr,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "sampler"
+    };
+
+    if (esp_timer_create(&args, &timer) != ESP_OK) {
+      Serial.println("Failed to create sampler timer!");
+      vTaskDelete(task);
+      task = nullptr;
+      timer = nullptr;
+      return false;
+    }
+
+    setFrequency(hz);
+    return true;
+  }
+
+  void end() {
+    if (timer != nullptr) {
+      esp_timer_stop(timer);
+      esp_timer_delete(timer);
+      timer = nullptr;
+    }
+
+    if (task != nullptr) {
+      vTaskDelete(task);
+      task = nullptr;
+    }
+
+    frequency_hz = 0;
+    buffer.clear();
+  }
+
+  bool running() {
+    return timer != nullptr;
+  }
+
+  void setFrequency(int hz) {
+    if (timer == nullptr || hz <= 0 || hz == frequency_hz) {
+      return;
+    }
+
+    esp_timer_stop(timer);
+    frequency_hz = hz;
+    resetStats();
+    esp_timer_start_periodic(timer, 1000000 / hz);
+  }
+
+  int getFrequency() {
+    return frequency_hz;
+  }
+
+  bool read(PressureSample &sample) {
+    return buffer.pop(sample);
+  }
+
+  size_t available() {
+    return buffer.available();
+  }
+
+  void getStats(SamplerStats &out) {
+    out = stats;
+  }
+
+  void resetStats() {
+    stats = SamplerStats();
+    stats.period_us = frequency_hz > 0 ? 1000000 / frequency_hz : 0;
+    stats.min_interval_us = UINT32_MAX;
+    last_sample_us = 0;
+  }
+
+  void printStats(String &out) {
+    SamplerStats s;
+    getStats(s);
+
+    if (!running()) {
+      out += "Sampler not running.\n";
+      return;
+    }
+
+    out += "Rate: " + String(frequency_hz) + " Hz (" + String(s.period_us) + " us)\n";
+    out += "Samples: " + String(s.samples) + ", dropped: " + String(s.dropped) + "\n";
+
+    if (s.samples > 1) {
+      out += "Interval: " + String(s.min_interval_us) + " - " + String(s.max_interval_us) + " us\n";
+      out += "Jitter: mean " + String((uint32_t)(s.total_jitter_us / (s.samples - 1))) +
+             " us, max " + String(s.max_jitter_us) + " us\n";
+    }
+
+    out += "Buffered: " + String(available()) + "/" + String(SAMPLER_BUFFER_SIZE - 1) + "\n";
+  }
+
+  namespace {
+    /**
+     * Runs in the esp_timer task. Kept to a single notify so the timer
+     * service stays free for everyone else.
+     */
+    void onTimer(void*) {
+      xTaskNotifyGive(task);
+    }
+
+    void samplerTask(void*) {
+      for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        PressureSample sample;
+        sample.timestamp_us = esp_timer_get_time();
+        sample.pressure = Hardware::getPressure();
+
+        if (last_sample_us > 0) {
+          uint32_t interval = sample.timestamp_us - last_sample_us;
+          uint32_t jitter = abs((int32_t)interval - (int32_t)stats.period_us);
+
+          stats.min_interval_us = min(stats.min_interval_us, interval);
+          stats.max_interval_us = max(stats.max_interval_us, interval);
+          stats.max_jitter_us = max(stats.max_jitter_us, jitter);
+          stats.total_jitter_us += jitter;
+        }
+
+        last_sample_us = sample.timestamp_us;
+        stats.samples++;
+
+        if (!buffer.push(sample)) {
+          stats.dropped++;
+        }
+      }
+    }
+  }
+}
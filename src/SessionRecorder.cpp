@@ -0,0 +1,180 @@
+#include "../include/SessionRecorder.h"
+#include "../include/UserInterface.h"
+#include "../include/WiFiHelper.h"
+#include <SD.h>
+#include <atomic>
+
+namespace SessionRecorder {
+  namespace {
+    File file;
+    String filename;
+
+    uint8_t buffers[2][RECORDER_SECTOR_SIZE];
+    std::atomic<bool> buffer_ready[2];
+    uint8_t active_buffer = 0;
+    size_t active_fill = 0;
+
+    std::atomic<bool> recording{false};
+    std::atomic<bool> closing{false};
+    uint32_t dropped = 0;
+
+    void writeHeader();
+    void closeFile();
+  }
+
+  bool start() {
+    if (isRecording()) {
+      stop();
+    }
+
+    // The last file is still the background loop's until it's closed:
+    if (closing) {
+      UI.toast("Still saving last\nrecording, try again.");
+      return false;
+    }
+
+    UI.toastNow("Preparing\nrecording...", 0);
+
+    struct tm timeinfo;
+    char filename_date[16];
+    if(!WiFiHelper::connected() || !getLocalTime(&timeinfo)){
+      Serial.println("Failed to obtain time");
+      sprintf(filename_date, "%lu", millis());
+    } else {
+      strftime(filename_date, 16, "%Y%m%d-%H%M%S", &timeinfo);
+    }
+
+    filename = "/log-" + String(filename_date) + ".rec";
+    Serial.println("Opening logfile: " + filename);
+    file = SD.open(filename, FILE_WRITE);
+
+    if (!file) {
+      Serial.println("Couldn't open logfile to save!");
+      UI.toast("Error opening\nlogfile!");
+      return false;
+    }
+
+    writeHeader();
+
+    active_buffer = 0;
+    active_fill = 0;
+    dropped = 0;
+    buffer_ready[0] = false;
+    buffer_ready[1] = false;
+    recording = true;
+
+    UI.drawRecordIcon(1, 1500);
+    UI.toast(String("Recording started:\n" + filename).c_str());
+    return true;
+  }
+
+  void stop() {
+    if (!isRecording()) {
+      return;
+    }
+
+    Serial.println("Closing logfile.");
+
+    // Producer and stop() both run on the control loop, so once this is
+    // cleared nothing else touches the active buffer.
+    recording = false;
+    closing = true;
+
+    // The background loop flushes and closes, and says so when it's done.
+    // Nothing here waits on the card, so control steps carry on meanwhile.
+    // The icon is drawn from here, since it goes straight into the frame.
+    UI.drawRecordIcon(0);
+    UI.toast("Saving recording...", 0);
+  }
+
+  bool isRecording() {
+    return recording || closing;
+  }
+
+  String getFilename() {
+    return filename;
+  }
+
+  uint32_t getDroppedCount() {
+    return dropped;
+  }
+
+  void record(const Reading &reading) {
+    if (!recording) {
+      return;
+    }
+
+    // Both halves are waiting on the SD card; drop rather than stall.
+    if (buffer_ready[active_buffer]) {
+      dropped++;
+      return;
+    }
+
+    memcpy(&buffers[active_buffer][active_fill], &reading, sizeof(Reading));
+    active_fill += sizeof(Reading);
+
+    if (active_fill + sizeof(Reading) > RECORDER_SECTOR_SIZE) {
+      // Zero the tail, in case Reading stops dividing the sector evenly.
+      memset(&buffers[active_buffer][active_fill], 0, RECORDER_SECTOR_SIZE - active_fill);
+      buffer_ready[active_buffer] = true;
+      active_buffer ^= 1;
+      active_fill = 0;
+    }
+  }
+
+  /**
+   * Called from the background loop. Writes out any full halves, and finishes
+   * the file once stop() has been requested.
+   */
+  void tick() {
+    for (int i = 0; i < 2; i++) {
+      if (buffer_ready[i]) {
+        file.write(buffers[i], RECORDER_SECTOR_SIZE);
+        buffer_ready[i] = false;
+      }
+    }
+
+    if (closing) {
+      // Partial sector last; readers stop at the end of the file.
+      if (active_fill > 0) {
+        file.write(buffers[active_buffer], active_fill);
+        active_fill = 0;
+      }
+
+      closeFile();
+      closing = false;
+
+      if (dropped > 0) {
+        Serial.println("Recording dropped " + String(dropped) + " samples.");
+      }
+
+      UI.toast("Recording stopped.");
+    }
+  }
+
+  namespace {
+    void writeHeader() {
+      uint8_t sector[RECORDER_SECTOR_SIZE] = {0};
+      RecordingHeader *header = (RecordingHeader*) sector;
+
+      memcpy(header->magic, RECORDER_MAGIC, sizeof(header->magic));
+      header->version = RECORDER_FORMAT_VERSION;
+      header->header_size = RECORDER_SECTOR_SIZE;
+      header->record_size = sizeof(Reading);
+      header->update_frequency_hz = Config.update_frequency_hz;
+      header->start_millis = millis();
+
+      struct tm timeinfo;
+      if (WiFiHelper::connected() && getLocalTime(&timeinfo)) {
+        strftime(header->start_time, sizeof(header->start_time), "%Y%m%d-%H%M%S", &timeinfo);
+      }
+
+      file.write(sector, RECORDER_SECTOR_SIZE);
+    }
+
+    void closeFile() {
+      file.close();
+      file = File();
+    }
+  }
+}
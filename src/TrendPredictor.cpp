@@ -0,0 +1,107 @@
+#include "../include/TrendPredictor.h"
+
+void TrendPredictor::addValue(fixed_t value) {
+  if (block_size == 1) {
+    addPoint(value);
+    return;
+  }
+
+  block_sum += value;
+  if (++block_fill >= block_size) {
+    addPoint((fixed_t)(block_sum / (int64_t) block_size));
+    block_sum = 0;
+    block_fill = 0;
+  }
+}
+
+void TrendPredictor::reset() {
+  head = 0;
+  filled = 0;
+  block_fill = 0;
+  block_sum = 0;
+  sum_y = 0;
+  sum_xy = 0;
+}
+
+void TrendPredictor::setWindow(size_t samples) {
+  samples = max(samples, (size_t) 2);
+
+  // Fewest samples per point that fit the window in the ring:
+  size_t size = (samples + TREND_MAX_POINTS - 1) / TREND_MAX_POINTS;
+  size_t points = max(samples / size, (size_t) 2);
+  if (points == window && size == block_size) {
+    return;
+  }
+
+  window = points;
+  block_size = size;
+  reset();
+}
+
+/**
+ * slope = (n * Sxy - Sx * Sy) / (n * Sxx - Sx^2), where for x = 0..n-1
+ * Sx = n(n - 1) / 2 and the denominator is n^2 (n^2 - 1) / 12. That's per
+ * point, and a point is block_size samples.
+ */
+fixed_t TrendPredictor::getSlope() {
+  if (!ready()) {
+    return 0;
+  }
+
+  int64_t n = window;
+  int64_t sum_x = n * (n - 1) / 2;
+  int64_t denominator = n * n * (n * n - 1) / 12;
+
+  return (fixed_t)((n * sum_xy - sum_x * sum_y) / (denominator * (int64_t) block_size));
+}
+
+fixed_t TrendPredictor::getFitted() {
+  if (!ready()) {
+    return filled > 0 ? history[(head + window - 1) % window] : 0;
+  }
+
+  // The line passes through the mean, at x = (n - 1) / 2:
+  int64_t slope = getSlope();
+  int64_t fitted = sum_y / (int64_t) window + slope * (int64_t)(window - 1) * (int64_t) block_size / 2;
+
+  // The newest point stands for the middle of its block, and samples since
+  // then haven't made a point yet:
+  return (fixed_t)(fitted + slope * (int64_t)(block_size - 1 + 2 * block_fill) / 2);
+}
+
+long TrendPredictor::samplesUntil(fixed_t level) {
+  if (!ready()) {
+    return -1;
+  }
+
+  fixed_t fitted = getFitted();
+  if (fitted >= level) {
+    return 0;
+  }
+
+  fixed_t slope = getSlope();
+  if (slope <= 0) {
+    return -1;
+  }
+
+  return ((int64_t) level - fitted + slope - 1) / slope;
+}
+
+// Private
+
+void TrendPredictor::addPoint(fixed_t value) {
+  if (filled < window) {
+    // Still filling, the new point lands at x = filled:
+    sum_xy += (int64_t) filled * value;
+    sum_y += value;
+    filled++;
+  } else {
+    fixed_t oldest = history[head];
+    sum_y -= oldest;
+    sum_xy += (int64_t)(window - 1) * value - sum_y;
+    sum_y += value;
+  }
+
+  history[head] = value;
+  head = (head + 1) % window;
+}
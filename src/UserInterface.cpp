@@ -1,12 +1,32 @@
 #include "../include/UserInterface.h"
 #include "../include/Icons.h"
 #include "../include/WebSocketHelper.h"
+#include "../include/AccessoryLink.h"
 
 #include "../include/Page.h"
 
 #define icon_y(idx) (SCREEN_WIDTH - (10 * (idx + 1)) + 2)
 
-UserInterface::UserInterface(Adafruit_SSD1306 *display) {
+namespace {
+  /**
+   * The NoGasm+ panel shares Wire with the digipot and the accessories, which
+   * run off other tasks, so every transfer the render task makes holds the bus.
+   * The SPI panel has its own.
+   */
+  void takeDisplayBus() {
+#ifdef NG_PLUS
+    while (!AccessoryLink::takeBus(ACCESSORY_RETRY_MAX_MS)) {}
+#endif
+  }
+
+  void giveDisplayBus() {
+#ifdef NG_PLUS
+    AccessoryLink::giveBus();
+#endif
+  }
+}
+
+UserInterface::UserInterface(PartialSSD1306 *display) {
   this->display = display;
 }
 
@@ -20,6 +40,12 @@ bool UserInterface::begin() {
     display->setTextSize(1);
     display->setTextColor(SSD1306_WHITE, SSD1306_BLACK);
   }
+
+  if (!startRenderTask()) {
+    Serial.println("Render task failed to start, rendering inline.");
+  }
+
+  return true;
 }
 
 void UserInterface::drawStatus(const char *s) {
@@ -346,11 +372,18 @@ void UserInterface::fadeTo(byte color, bool half) {
         }
       }
 
-      this->display->display();
-      if (!half)
-        delay(200 / increment);
+      // With a render task, it plays the fade back instead (see sendFade).
+      if (render_task == nullptr) {
+        this->display->display();
+        if (!half)
+          delay(200 / increment);
+      }
     }
   }
+
+  if (render_task != nullptr) {
+    queueFrame(!half);
+  }
 }
 
 void UserInterface::clear(bool render) {
@@ -360,12 +393,31 @@ void UserInterface::clear(bool render) {
     this->display->fillRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, SSD1306_BLACK);
 }
 
-void UserInterface::render() {
-  if (display_on) {
-    this->display->display();
+/**
+ * Hands the framebuffer to the render task, which puts it on the bus. Only a
+ * memcpy happens here, so the control loop never waits on the display. If
+ * the task hasn't picked up the last frame yet, that one is dropped.
+ *
+ * force sends the frame even while the display is turned off.
+ */
+void UserInterface::render(bool force) {
+  if (display_on || force) {
+    queueFrame(false);
   }
 }
 
+void UserInterface::dim(bool dim) {
+  if (render_task == nullptr) {
+    display->dim(dim);
+    return;
+  }
+
+  xSemaphoreTake(frame_lock, portMAX_DELAY);
+  pending_dim = dim;
+  xSemaphoreGive(frame_lock);
+  xTaskNotifyGive(render_task);
+}
+
 void UserInterface::drawIcon(byte icon_idx, byte icon_graphic[][8], byte status, long flash_ms) {
   UIIcon *icon = &icons[icon_idx];
   byte icon_frame_idx;
@@ -560,4 +612,132 @@ void UserInterface::tick() {
 bool UserInterface::hasToast() {
   bool has_toast = toast_message[0] != '\0' && (toast_expiration == 0 || millis() < toast_expiration);
   return has_toast;
-}
\ No newline at end of file
+}
+
+// Render Task
+
+bool UserInterface::startRenderTask() {
+  const size_t frame_size = SCREEN_WIDTH * ((SCREEN_HEIGHT + 7) / 8);
+
+  // Bit-banged displays can only send their own buffer.
+  if (!display->hasBus()) {
+    return false;
+  }
+
+  frames[0] = (uint8_t*) malloc(frame_size);
+  frames[1] = (uint8_t*) malloc(frame_size);
+  fade_frame = (uint8_t*) malloc(frame_size);
+  frame_lock = xSemaphoreCreateMutex();
+
+  if (frames[0] == nullptr || frames[1] == nullptr || fade_frame == nullptr || frame_lock == nullptr) {
+    return false;
+  }
+
+  memcpy(frames[1], display->getBuffer(), frame_size);
+
+  // Core 0, next to the background loop; core 1 is left to sensing.
+  return xTaskCreatePinnedToCore(
+      renderTask,
+      "renderTask",
+      4096,
+      this,
+      1,
+      &render_task,
+      0
+  ) == pdPASS;
+}
+
+void UserInterface::queueFrame(bool fade) {
+  if (render_task == nullptr) {
+    display->display();
+    return;
+  }
+
+  xSemaphoreTake(frame_lock, portMAX_DELAY);
+  if (frame_pending) {
+    frames_superseded++;
+  }
+
+  memcpy(frames[0], display->getBuffer(), SCREEN_WIDTH * ((SCREEN_HEIGHT + 7) / 8));
+  frame_pending = true;
+  frame_fade = frame_fade || fade;
+  xSemaphoreGive(frame_lock);
+
+  xTaskNotifyGive(render_task);
+}
+
+/**
+ * Plays back fadeTo() on the render task: the new frame is revealed through
+ * the same dither steps, one bus transfer and pause per step.
+ */
+void UserInterface::sendFade(const uint8_t *frame) {
+  for (byte a = 0; a < 2; a++) {
+    for (byte b = 0; b < 2; b++) {
+      byte increment = (a == 1 || b == 1) ? 2 : 4;
+
+      // Rows within a page are bits, so one mask covers every page.
+      uint8_t mask = 0;
+      for (byte j = b; j < 8; j += increment) {
+        mask |= 1 << j;
+      }
+
+      for (byte i = a; i < SCREEN_WIDTH; i += increment) {
+        for (int page = 0; page < (SCREEN_HEIGHT + 7) / 8; page++) {
+          int idx = page * SCREEN_WIDTH + i;
+          fade_frame[idx] = (fade_frame[idx] & ~mask) | (frame[idx] & mask);
+        }
+      }
+
+      takeDisplayBus();
+      display->display(fade_frame);
+      giveDisplayBus();
+      vTaskDelay(pdMS_TO_TICKS(200 / increment));
+    }
+  }
+}
+
+void UserInterface::renderTask(void *param) {
+  UserInterface *ui = (UserInterface*) param;
+  const size_t frame_size = SCREEN_WIDTH * ((SCREEN_HEIGHT + 7) / 8);
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    xSemaphoreTake(ui->frame_lock, portMAX_DELAY);
+    bool send = ui->frame_pending;
+    bool fade = ui->frame_fade;
+    int8_t dim = ui->pending_dim;
+
+    if (send) {
+      // frames[1] is still what the panel shows, the fade starts from it.
+      if (fade) {
+        memcpy(ui->fade_frame, ui->frames[1], frame_size);
+      }
+
+      uint8_t *front = ui->frames[0];
+      ui->frames[0] = ui->frames[1];
+      ui->frames[1] = front;
+    }
+
+    ui->frame_pending = false;
+    ui->frame_fade = false;
+    ui->pending_dim = -1;
+    xSemaphoreGive(ui->frame_lock);
+
+    if (dim >= 0) {
+      takeDisplayBus();
+      ui->display->dim(dim);
+      giveDisplayBus();
+    }
+
+    if (send) {
+      if (fade) {
+        ui->sendFade(ui->frames[1]);
+      }
+
+      takeDisplayBus();
+      ui->display->display(ui->frames[1]);
+      giveDisplayBus();
+    }
+  }
+}
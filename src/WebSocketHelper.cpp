@@ -10,21 +10,33 @@
 #include "../include/Hardware.h"
 #include "../include/Page.h"
 #include "../include/SDHelper.h"
+#include "../include/AdcCapture.h"
+#include "../include/WiFiHelper.h"
 
 #include "../config.h"
 
 namespace WebSocketHelper {
   void begin() {
-    // Start WebSocket server and assign callback
-    webSocket = new RedirectingWebSocketsServer(Config.websocket_port);
-    webSocket->begin();
-    webSocket->onEvent(onWebSocketEvent);
+    // Start WebSocket server and assign callback. It's only published once
+    // running, as the loop and background task may already be sending:
+    RedirectingWebSocketsServer *server = new RedirectingWebSocketsServer(Config.websocket_port);
+    server->begin();
+    server->onEvent(onWebSocketEvent);
+    webSocket = server;
     Serial.println("Websocket server running.");
   }
 
   void tick() {
     if (webSocket != nullptr)
       webSocket->loop();
+
+    // Streams go out from here, on the same task that adds and drops clients:
+    if (OrgasmControl::getReadingCount() != streamed_reading_count) {
+      streamed_reading_count = OrgasmControl::getReadingCount();
+      sendReadings();
+    }
+
+    sendSamples();
   }
 
   void send(const char *cmd, JsonDocument &doc, int num) {
@@ -36,7 +48,7 @@ namespace WebSocketHelper {
     String payload;
     serializeJson(envelope, payload);
 
-    if (num > 0) {
+    if (num >= 0) {
       webSocket->sendTXT(num, payload);
     } else {
       for (auto const &p : connections) {
@@ -52,6 +64,22 @@ namespace WebSocketHelper {
     send(cmd, doc, num);
   }
 
+  /**
+   * Serializes a reading as a complete `readings` message.
+   */
+  void serializeReading(const Reading &reading, String &out) {
+    StaticJsonDocument<JSON_OBJECT_SIZE(1) + JSON_OBJECT_SIZE(5)> doc;
+    JsonObject readings = doc.createNestedObject("readings");
+    readings["pressure"] = reading.pressure;
+    readings["pavg"] = reading.avg_pressure;
+    readings["baseline"] = reading.baseline;
+    readings["motor"] = reading.motor_speed;
+    readings["arousal"] = reading.arousal;
+    readings["millis"] = reading.millis;
+
+    serializeJson(doc, out);
+  }
+
   /*
    * Helpers here which handle sending all server responses.
    * The first parameter should be int num, followed by any additional
@@ -75,11 +103,19 @@ namespace WebSocketHelper {
     send("configList", doc, num);
   }
 
+  void sendSettingsChanged(ConfigKeySet keys, int num) {
+    DynamicJsonDocument doc(2048);
+    dumpConfigToJsonObject(doc, Config, keys);
+
+    send("configChanged", doc, num);
+  }
+
   void sendWxStatus(int num) {
     DynamicJsonDocument doc(200);
     doc["ssid"] = Config.wifi_ssid;
-    doc["ip"] = WiFi.localIP().toString();
-    doc["rssi"] = WiFi.RSSI();
+    doc["ip"] = WiFiHelper::ip();
+    doc["rssi"] = WiFiHelper::rssi();
+    doc["state"] = WiFiHelper::getStateName(WiFiHelper::getState());
 
     send("wifiStatus", doc, num);
   }
@@ -109,20 +145,62 @@ namespace WebSocketHelper {
     send("sdStatus", doc, num);
   }
 
+  /**
+   * Sends the latest control step to every subscribed client that is due one,
+   * or to just `num` if given. Called from tick() whenever there are new
+   * steps; each client's subscription rate decides whether it gets this one,
+   * and batched clients get every step since their last batch. The JSON and
+   * binary payloads are each built at most once, however many clients there
+   * are.
+   */
   void sendReadings(int num) {
-//    String screenshot;
-//    UI.screenshot(screenshot);
-
-    // Serialize Data
-    DynamicJsonDocument doc(3072);
-    doc["pressure"] = OrgasmControl::getLastPressure();
-    doc["pavg"] = OrgasmControl::getAveragePressure();
-    doc["motor"] = Hardware::getMotorSpeed();
-    doc["arousal"] = OrgasmControl::getArousal();
-    doc["millis"] = millis();
-//    doc["screenshot"] = screenshot;
-
-    send("readings", doc, num);
+    if (webSocket == nullptr) return;
+
+    // From the history, as the control loop may be writing the next step:
+    Reading reading;
+    if (!OrgasmControl::getHistoricReading(OrgasmControl::getReadingCount() - 1, reading)) {
+      return;
+    }
+
+    long now = millis();
+    String json;
+
+    struct __attribute__((packed)) {
+      ReadingsFrameHeader header;
+      Reading reading;
+    } frame = { { WS_BIN_READINGS, 1 }, reading };
+
+    for (auto const &p : connections) {
+      WebSocketConnection *client = p.second;
+
+      if (num >= 0) {
+        if (client->num != num) continue;
+      } else {
+        if (!client->stream_readings) continue;
+
+        if (client->readings_batch > 0) {
+          sendReadingsBatches(client);
+          continue;
+        }
+
+        if (now - client->next_readings_ms < 0) continue;
+
+        // Keep the average rate exact, but don't burst to catch up after a stall.
+        client->next_readings_ms += client->readings_period_ms;
+        if (now - client->next_readings_ms > client->readings_period_ms) {
+          client->next_readings_ms = now + client->readings_period_ms;
+        }
+      }
+
+      if (client->readings_format == ReadingsBinary) {
+        webSocket->sendBIN(client->num, (uint8_t*) &frame, sizeof(frame));
+      } else {
+        if (json.length() == 0) {
+          serializeReading(reading, json);
+        }
+        webSocket->sendTXT(client->num, json);
+      }
+    }
   }
 
   /*
@@ -204,11 +282,14 @@ namespace WebSocketHelper {
   void cbConfigSet(int num, JsonVariant args) {
     auto config = args.as<JsonObject>();
     bool restart_required = false;
+    uint8_t changed = 0;
 
     for (auto kvp : config) {
-      setConfigValue(kvp.key().c_str(), kvp.value().as<String>().c_str(), restart_required);
+      storeConfigValue(kvp.key().c_str(), kvp.value().as<String>().c_str(), changed);
     }
 
+    applyConfigChanges(changed, restart_required);
+
     // Send new settings to client:
     saveConfigToSd(millis() + 300);
   }
@@ -221,7 +302,137 @@ namespace WebSocketHelper {
     Hardware::setMotorSpeed(speed);
   }
 
+  /**
+   * Accepts `true` / `false`, a rate in Hz (0 to stop), or
+   * `{ "rate": 30, "format": "binary" }`, or `{ "batch": 10 }` for every
+   * control step, in binary frames of 10.
+   */
+  void cbStreamReadings(int num, JsonVariant args) {
+    WebSocketConnection *client = connections[num];
+    int rate_hz = WS_DEFAULT_READINGS_HZ;
+    client->readings_batch = 0;
+
+    if (args.is<bool>()) {
+      client->stream_readings = args.as<bool>();
+    } else if (args.is<int>()) {
+      rate_hz = args.as<int>();
+      client->stream_readings = rate_hz > 0;
+    } else if (args.is<JsonObject>()) {
+      rate_hz = args["rate"] | WS_DEFAULT_READINGS_HZ;
+      client->stream_readings = rate_hz > 0;
+
+      const char *format = args["format"] | "json";
+      client->readings_format = strcmp(format, "binary") ? ReadingsJson : ReadingsBinary;
+
+      // Batches are always binary and always full rate.
+      int batch = args["batch"] | 0;
+      client->readings_batch = max(0, min(batch, WS_MAX_READINGS_BATCH));
+      if (client->readings_batch > 0) {
+        client->stream_readings = true;
+        client->readings_format = ReadingsBinary;
+        client->next_reading_index = OrgasmControl::getReadingCount();
+      }
+    }
+
+    if (rate_hz > 0) {
+      // Can't go faster than the control loop produces them.
+      client->readings_period_ms = 1000 / min(rate_hz, max(Config.update_frequency_hz, 1));
+      client->next_readings_ms = millis();
+    }
+  }
+
+  /**
+   * `true` to receive every ADC capture block as a binary samples frame, if
+   * adc_capture_hz is set.
+   */
+  void cbStreamSamples(int num, JsonVariant args) {
+    WebSocketConnection *client = connections[num];
+    client->stream_samples = args.as<bool>();
+
+    if (client->stream_samples && !AdcCapture::running()) {
+      send("error", "ADC capture is not running.", num);
+      client->stream_samples = false;
+      return;
+    }
+
+    if (client->stream_samples && capture_consumer < 0) {
+      capture_consumer = AdcCapture::subscribe("websocket");
+    }
+  }
+
   namespace {
+    /**
+     * Forwards captured blocks to clients streaming samples. Runs from tick(),
+     * and always drains the queue so held blocks go back to the pool even
+     * with nobody listening.
+     */
+    void sendSamples() {
+      if (capture_consumer < 0) return;
+
+      SampleBlock *block;
+      while (AdcCapture::receive(capture_consumer, block)) {
+        struct __attribute__((packed)) {
+          SamplesFrameHeader header;
+          uint16_t samples[SAMPLE_BLOCK_SIZE];
+        } frame;
+        bool built = false;
+
+        for (auto const &p : connections) {
+          WebSocketConnection *client = p.second;
+          if (!client->stream_samples) continue;
+
+          if (!built) {
+            frame.header.type = WS_BIN_SAMPLES;
+            frame.header.reserved = 0;
+            frame.header.count = block->count;
+            frame.header.sequence = block->sequence;
+            frame.header.sample_rate_hz = block->sample_rate_hz;
+            frame.header.timestamp_us = block->timestamp_us;
+            memcpy(frame.samples, block->samples, block->count * sizeof(uint16_t));
+            built = true;
+          }
+
+          webSocket->sendBIN(client->num, (uint8_t*) &frame,
+                             sizeof(SamplesFrameHeader) + block->count * sizeof(uint16_t));
+        }
+
+        AdcCapture::release(block);
+      }
+    }
+
+    /**
+     * Sends every full batch this client has waiting. Readings come straight
+     * out of OrgasmControl's history, so each client just keeps a cursor.
+     */
+    void sendReadingsBatches(WebSocketConnection *client) {
+      uint32_t count = OrgasmControl::getReadingCount();
+
+      // Fell out of the history window, skip ahead (the sequence gap tells the client).
+      if (count - client->next_reading_index > READING_HISTORY_SIZE) {
+        client->next_reading_index = count - READING_HISTORY_SIZE;
+      }
+
+      while (count - client->next_reading_index >= client->readings_batch) {
+        struct __attribute__((packed)) {
+          ReadingsBatchHeader header;
+          Reading readings[WS_MAX_READINGS_BATCH];
+        } frame;
+
+        frame.header.type = WS_BIN_READINGS_BATCH;
+        frame.header.count = client->readings_batch;
+        frame.header.sequence = client->next_reading_index;
+
+        for (int i = 0; i < client->readings_batch; i++) {
+          OrgasmControl::getHistoricReading(client->next_reading_index + i, frame.readings[i]);
+        }
+
+        client->next_reading_index += client->readings_batch;
+
+        webSocket->sendBIN(client->num, (uint8_t*) &frame,
+                           sizeof(ReadingsBatchHeader) + client->readings_batch * sizeof(Reading));
+      }
+    }
+
     void onMessage(int num, uint8_t * payload) {
       Serial.printf("[%u] %s", num, payload);
       Serial.println();
@@ -252,8 +463,9 @@ namespace WebSocketHelper {
           } else if (! strcmp(cmd, "setMotor")) {
              cbSetMotor(num, kvp.value());
           } else if (! strcmp(cmd, "streamReadings")) {
-            WebSocketConnection *client = connections[num];
-            client->stream_readings = kvp.value();
+            cbStreamReadings(num, kvp.value());
+          } else if (! strcmp(cmd, "streamSamples")) {
+            cbStreamSamples(num, kvp.value());
           } else if (! strcmp(cmd, "dir")) {
             cbDir(num, kvp.value());
           } else if (! strcmp(cmd, "mkdir")) {
@@ -291,6 +503,8 @@ namespace WebSocketHelper {
 
           last_connection = num;
           sendSystemInfo(num);
+          // Status is only broadcast on change, so a new client needs its own:
+          sendWxStatus(num);
           Serial.printf("[%u] Connection from ", num);
           Serial.println(ip.toString());
         }
@@ -1,15 +1,139 @@
 #include "../include/WiFiHelper.h"
 
 #include "../include/UserInterface.h"
+#include "../include/WebSocketHelper.h"
 #include <WiFi.h>
 
 namespace WiFiHelper {
+  namespace {
+    // Guards what the event callback shares with the loop.
+    portMUX_TYPE wifi_mux = portMUX_INITIALIZER_UNLOCKED;
+    WiFiState state = WiFiOff;
+    uint32_t attempt_at = 0;
+    uint32_t retry_at = 0;
+    uint32_t retry_ms = WIFI_RETRY_MIN_MS;
+    uint8_t last_reason = 0;
+    uint32_t attempts = 0;
+    uint32_t drops = 0;
+
+    // Only begin() and tick() touch these.
+    bool events_registered = false;
+    bool clock_set = false;
+    int cached_rssi = 0;
+    uint32_t rssi_at = 0;
+    WiFiState reported_state = WiFiOff;
+    int reported_rssi = 0;
+
+    // Call with wifi_mux held.
+    void scheduleRetry() {
+      state = WiFiWaiting;
+      retry_at = millis() + retry_ms;
+      retry_ms = min(retry_ms * 2, (uint32_t) WIFI_RETRY_MAX_MS);
+    }
+
+    /**
+     * Runs on the WiFi event task. Only moves the state along; the loop does
+     * anything that takes time.
+     */
+    void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+      portENTER_CRITICAL(&wifi_mux);
+      switch (event) {
+        case SYSTEM_EVENT_STA_GOT_IP:
+          if (state != WiFiOff) {
+            state = WiFiConnected;
+            retry_ms = WIFI_RETRY_MIN_MS;
+          }
+          break;
+
+        case SYSTEM_EVENT_STA_LOST_IP:
+          // Still associated, so DHCP gets until the attempt timeout:
+          if (state == WiFiConnected) {
+            state = WiFiConnecting;
+            attempt_at = millis();
+            drops++;
+          }
+          break;
+
+        case SYSTEM_EVENT_STA_DISCONNECTED:
+          if (state == WiFiConnected) {
+            drops++;
+          }
+
+          if (state == WiFiConnecting || state == WiFiConnected) {
+            last_reason = info.disconnected.reason;
+            scheduleRetry();
+          }
+          break;
+
+        default:
+          break;
+      }
+      portEXIT_CRITICAL(&wifi_mux);
+    }
+
+    void connect() {
+      portENTER_CRITICAL(&wifi_mux);
+      state = WiFiConnecting;
+      attempt_at = millis();
+      attempts++;
+      portEXIT_CRITICAL(&wifi_mux);
+
+      WiFi.begin(Config.wifi_ssid, Config.wifi_key);
+    }
+
+    void onStateChanged(WiFiState current) {
+      Serial.print("WiFi: ");
+      Serial.println(getStateName(current));
+
+      if (current == WiFiConnected) {
+        Serial.print("My IP address: ");
+        Serial.println(WiFi.localIP());
+
+        cached_rssi = WiFi.RSSI();
+        rssi_at = millis();
+
+        // Synchronize Local Clock. This only starts SNTP, it doesn't wait:
+        if (!clock_set) {
+          const char* ntpServer = "pool.ntp.org";
+          const long  gmtOffset_sec = 0;
+          const int   daylightOffset_sec = 3600;
+          configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
+          clock_set = true;
+        }
+      } else {
+        cached_rssi = 0;
+      }
+    }
+  }
+
   void drawSignalIcon() {
     UI.drawWifiIcon(getWiFiStrength() + 1);
   }
 
   bool connected() {
-    return WiFi.status() == WL_CONNECTED;
+    return getState() == WiFiConnected;
+  }
+
+  WiFiState getState() {
+    portENTER_CRITICAL(&wifi_mux);
+    WiFiState current = state;
+    portEXIT_CRITICAL(&wifi_mux);
+    return current;
+  }
+
+  const char *getStateName(WiFiState state) {
+    switch (state) {
+      case WiFiOff:
+        return "off";
+      case WiFiConnecting:
+        return "connecting";
+      case WiFiConnected:
+        return "connected";
+      case WiFiWaiting:
+        return "retrying";
+      default:
+        return "unknown";
+    }
   }
 
   String ip() {
@@ -20,49 +144,74 @@ namespace WiFiHelper {
     }
   }
 
+  int rssi() {
+    return cached_rssi;
+  }
+
   bool begin() {
-    if (!Config.wifi_on) {
+    if (!Config.wifi_on || Config.wifi_ssid[0] == '\0') {
       return false;
     }
 
-    // Connect to access point
-    Serial.print("Connecting..");
-    WiFi.begin(Config.wifi_ssid, Config.wifi_key);
-    UI.display->setCursor(0,0);
-    int count = 0;
-    long connection_start_at_ms = millis();
-    while ( WiFi.status() != WL_CONNECTED) {
-      Serial.print(".");
-      if (millis() - connection_start_at_ms > CONNECTION_TIMEOUT_S * 1000) {
-        Serial.println();
-        Serial.print("Connection timed out!");
-        return false;
-      }
-      delay(500);
+    if (!events_registered) {
+      WiFi.onEvent(onWiFiEvent);
+      events_registered = true;
     }
 
-    // Print our IP address
-    Serial.println(" Connected!");
-    Serial.print("My IP address: ");
-    Serial.println(WiFi.localIP());
-
-    // Synchronize Local Clock
-    const char* ntpServer = "pool.ntp.org";
-    const long  gmtOffset_sec = 0;
-    const int   daylightOffset_sec = 3600;
-    configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
-
-    // Time Example TODO-Remove
-    struct tm timeinfo;
-    if(!getLocalTime(&timeinfo)){
-      Serial.println("Failed to obtain time");
-      return false;
-    }
+    // Reconnects are ours, with backoff, not the driver's right away:
+    WiFi.setAutoReconnect(false);
+
+    portENTER_CRITICAL(&wifi_mux);
+    retry_ms = WIFI_RETRY_MIN_MS;
+    portEXIT_CRITICAL(&wifi_mux);
 
-    Serial.println(&timeinfo, "%A, %B %d %Y %H:%M:%S");
+    Serial.print("Connecting to ");
+    Serial.println(Config.wifi_ssid);
+    connect();
     return true;
   }
 
+  void tick() {
+    uint32_t now = millis();
+    WiFiState current;
+    bool retry = false;
+    bool timed_out = false;
+
+    portENTER_CRITICAL(&wifi_mux);
+    current = state;
+    if (current == WiFiWaiting) {
+      retry = (int32_t) (now - retry_at) >= 0;
+    } else if (current == WiFiConnecting && now - attempt_at > CONNECTION_TIMEOUT_S * 1000) {
+      // Moved on before disconnecting, so the event it raises is ignored:
+      timed_out = true;
+      scheduleRetry();
+      current = state;
+    }
+    portEXIT_CRITICAL(&wifi_mux);
+
+    if (timed_out) {
+      Serial.println("Connection timed out!");
+      WiFi.disconnect();
+    } else if (retry) {
+      connect();
+      current = WiFiConnecting;
+    }
+
+    if (current != reported_state) {
+      onStateChanged(current);
+    } else if (current == WiFiConnected && now - rssi_at >= WIFI_RSSI_INTERVAL_MS) {
+      cached_rssi = WiFi.RSSI();
+      rssi_at = now;
+    }
+
+    // Clients only hear about changes:
+    if (current != reported_state || abs(cached_rssi - reported_rssi) >= WIFI_RSSI_REPORT_DB) {
+      reported_state = current;
+      reported_rssi = cached_rssi;
+      WebSocketHelper::sendWxStatus();
+    }
+  }
+
   String signalStrengthStr() {
     switch(getWiFiStrength()) {
       case 0:
@@ -79,13 +228,40 @@ namespace WiFiHelper {
   }
 
   void disconnect() {
+    portENTER_CRITICAL(&wifi_mux);
+    state = WiFiOff;
+    portEXIT_CRITICAL(&wifi_mux);
+
     WiFi.disconnect(true);
   }
 
+  void printStatus(String &out) {
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&wifi_mux);
+    WiFiState current = state;
+    uint32_t retry_in = current == WiFiWaiting && (int32_t) (retry_at - now) > 0 ? retry_at - now : 0;
+    uint8_t reason = last_reason;
+    uint32_t tries = attempts;
+    uint32_t dropped = drops;
+    portEXIT_CRITICAL(&wifi_mux);
+
+    out += "State: " + String(getStateName(current));
+    if (current == WiFiWaiting) {
+      out += ", retry in " + String(retry_in) + " ms";
+    }
+    out += "\n";
+    out += "SSID: " + String(Config.wifi_ssid) + "\n";
+    out += "IP: " + ip() + "\n";
+    out += "RSSI: " + String(cached_rssi) + " dBm\n";
+    out += "Attempts: " + String(tries) + ", drops: " + String(dropped) + "\n";
+    out += "Last disconnect reason: " + String(reason) + "\n";
+  }
+
   namespace {
     byte getWiFiStrength() {
       byte wifiStrength;
-      int rssi = WiFi.RSSI();
+      int rssi = cached_rssi;
 
       if (rssi < -90) {
         wifiStrength = 0;
@@ -102,4 +278,4 @@ namespace WiFiHelper {
       return wifiStrength;
     }
   }
-}
\ No newline at end of file
+}
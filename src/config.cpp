@@ -9,54 +9,46 @@
 #include "../include/UserInterface.h"
 #include "../include/Hardware.h"
 #include "../include/Page.h"
+#include "../include/OrgasmControl.h"
+#include "../include/AutoCalibration.h"
+#include "../include/MotorOutput.h"
+#include "../include/AccessoryLink.h"
+#include "../include/ConfigSchema.h"
+#include "../include/ConfigStore.h"
 
 #include <FastLed.h>
 
 ConfigStruct Config;
 
-/**
- * Cast a string to a bool. Accepts "false", "no", "off", "0" to false, all other
- * strings cast to true.
- * @param a
- * @return
- */
-bool atob(const char *a) {
-//  for (int i = 0; a[i]; i++) {
-//    a[i] = tolower(a[i]);
-//  }
-
-  return !(
-      strcmp(a, "false") == 0 ||
-      strcmp(a, "no") == 0 ||
-      strcmp(a, "off") == 0 ||
-      strcmp(a, "0") == 0
-  );
-}
-
 /**
  * This code loads configuration into the Config struct.
  * @see config.h
  * void loadConfigFromSd();
  */
 void loadConfigFromSd() {
-  DynamicJsonDocument doc(2048);
+  DynamicJsonDocument doc(4096);
 
-  if (!SD.exists(CONFIG_FILENAME)) {
+  if (!ConfigStore::load(doc)) {
     Serial.println(F("Couldn't find config.json on your SD card!"));
-    loadConfigFromJsonObject(doc);
-    saveConfigToSd(0);
-  } else {
-    File configFile = SD.open(CONFIG_FILENAME);
-    DeserializationError e = deserializeJson(doc, configFile);
-
-    if (e) {
-      Serial.println(F("Failed to deserialize JSON, using default config!"));
-      Serial.println(F("^-- This means no WiFi. Please ensure your SD card has config.json present."));
-      Serial.println(e.c_str());
-    }
+    ConfigStore::compactSoon();
+  }
 
-    loadConfigFromJsonObject(doc);
+  loadConfigFromJsonObject(doc);
+  ConfigStore::markSaved();
+}
+
+/**
+ * Loads the config saved last time from flash, which takes no SD card and
+ * none of its time. The card's copy is checked against it once the
+ * background task is up, see ConfigStore.h.
+ */
+bool loadConfigFromCache() {
+  if (!ConfigStore::loadCached()) {
+    return false;
   }
+
+  OrgasmControl::configChanged();
+  return true;
 }
 
 /**
@@ -64,66 +56,66 @@ void loadConfigFromSd() {
  * mounted, as it executes no SD commands.
  */
 void loadDefaultConfig() {
-  DynamicJsonDocument doc(1);
-  loadConfigFromJsonObject(doc);
+  ConfigSchema::loadDefaults();
+  ConfigStore::markSaved();
+  OrgasmControl::configChanged();
 }
 
 void loadConfigFromJsonObject(JsonDocument &doc) {
-  // Copy WiFi Settings
-  strlcpy(Config.wifi_ssid, doc["wifi_ssid"] | "", sizeof(Config.wifi_ssid));
-  strlcpy(Config.wifi_key, doc["wifi_key"] | "", sizeof(Config.wifi_key));
-  Config.wifi_on = doc["wifi_on"] | false;
-
-  // Copy Bluetooth Settings
-  strlcpy(Config.bt_display_name, doc["bt_display_name"] | "NoGasm WiFi", sizeof(Config.bt_display_name));
-  Config.bt_on = doc["bt_on"] | false;
-
-  // Copy Network Settings
-  Config.websocket_port = doc["websocket_port"] | 80;
-  Config.classic_serial = doc["classic_serial"] | false;
-
-  // Copy UI Settings
-  Config.led_brightness = doc["led_brightness"] | 128;
-  Config.screen_dim_seconds = doc["screen_dim_seconds"] | 10;
-  Config.screen_timeout_seconds = doc["screen_timeout_seconds"] | 60;
-
-  // Copy Orgasm Settings
-  Config.motor_max_speed = doc["motor_max_speed"] | 128;
-  Config.pressure_smoothing = doc["pressure_smoothing"] | 5;
-  Config.sensitivity_threshold = doc["sensitivity_threshold"] | 600;
-  Config.motor_ramp_time_s = doc["motor_ramp_time_s"] | 30;
-  Config.update_frequency_hz = doc["update_frequency_hz"] | 50;
-  Config.sensor_sensitivity = doc["sensor_sensitivity"] | 128;
-  Config.use_average_values = doc["use_average_values"] | false;
+  ConfigSchema::loadDefaults();
+  loadConfigFromJsonObject(doc, Config);
+  OrgasmControl::configChanged();
+}
+
+void loadConfigFromJsonObject(JsonDocument &doc, ConfigStruct &to) {
+  for (size_t i = 0; i < ConfigSchema::count(); i++) {
+    const ConfigKey &key = *ConfigSchema::get(i);
+    JsonVariant value = doc[key.key];
+    if (value.isNull()) {
+      continue;
+    }
+
+    // A value of the wrong type leaves the key as it was:
+    switch (key.type) {
+      case ConfigString:
+        if (value.is<const char*>()) {
+          ConfigSchema::setString(key, value.as<const char*>(), to);
+        }
+        break;
+      case ConfigBool:
+        ConfigSchema::setLong(key, value | (bool) ConfigSchema::getLong(key, to), to);
+        break;
+      default:
+        ConfigSchema::setLong(key, value | ConfigSchema::getLong(key, to), to);
+        break;
+    }
+  }
 }
 
 void dumpConfigToJsonObject(JsonDocument &doc) {
-  // Copy WiFi Settings
-  doc["wifi_ssid"] = Config.wifi_ssid;
-  doc["wifi_key"] = Config.wifi_key;
-  doc["wifi_on"] = Config.wifi_on;
-
-  // Copy Bluetooth Settings
-  doc["bt_display_name"] = Config.bt_display_name;
-  doc["bt_on"] = Config.bt_on;
-
-  // Copy Network Settings
-  doc["websocket_port"] = Config.websocket_port;
-  doc["classic_serial"] = Config.classic_serial;
-
-  // Copy UI Settings
-  doc["led_brightness"] = Config.led_brightness;
-  doc["screen_dim_seconds"] = Config.screen_dim_seconds;
-  doc["screen_timeout_seconds"] = Config.screen_timeout_seconds;
-
-  // Copy Orgasm Settings
-  doc["motor_max_speed"] = Config.motor_max_speed;
-  doc["pressure_smoothing"] = Config.pressure_smoothing;
-  doc["sensitivity_threshold"] = Config.sensitivity_threshold;
-  doc["motor_ramp_time_s"] = Config.motor_ramp_time_s;
-  doc["update_frequency_hz"] = Config.update_frequency_hz;
-  doc["sensor_sensitivity"] = Config.sensor_sensitivity;
-  doc["use_average_values"] = Config.use_average_values;
+  dumpConfigToJsonObject(doc, Config, CONFIG_ALL_KEYS);
+}
+
+void dumpConfigToJsonObject(JsonDocument &doc, const ConfigStruct &from, ConfigKeySet keys) {
+  for (size_t i = 0; i < ConfigSchema::count(); i++) {
+    const ConfigKey &key = *ConfigSchema::get(i);
+    if (!(keys & ((ConfigKeySet) 1 << i))) {
+      continue;
+    }
+
+    switch (key.type) {
+      case ConfigString:
+        // Non-const, so the document takes a copy:
+        doc[key.key] = (char*) ConfigSchema::getString(key, from);
+        break;
+      case ConfigBool:
+        doc[key.key] = (bool) ConfigSchema::getLong(key, from);
+        break;
+      default:
+        doc[key.key] = ConfigSchema::getLong(key, from);
+        break;
+    }
+  }
 }
 
 bool dumpConfigToJson(String &str) {
@@ -139,142 +131,140 @@ bool dumpConfigToJson(String &str) {
   return true;
 }
 
+/**
+ * Takes on whatever the SD card's config.json changed over the cached config
+ * this booted with. Returns true if anything did.
+ */
+static bool applyConfigFromSd() {
+  ConfigStruct from_sd;
+  ConfigKeySet keys = ConfigStore::takeReconciled(from_sd);
+  if (keys == 0) {
+    return false;
+  }
+
+  uint8_t changed = 0;
+  for (size_t i = 0; i < ConfigSchema::count(); i++) {
+    const ConfigKey &key = *ConfigSchema::get(i);
+    if (!(keys & ((ConfigKeySet) 1 << i))) {
+      continue;
+    }
+
+    if (key.type == ConfigString) {
+      ConfigSchema::setString(key, ConfigSchema::getString(key, from_sd));
+    } else {
+      ConfigSchema::setLong(key, ConfigSchema::getLong(key, from_sd));
+    }
+
+    changed |= key.flags;
+  }
+
+  bool require_reboot = false;
+  applyConfigChanges(changed, require_reboot);
+
+  Serial.println(F("Applied config.json changes from the SD card."));
+  if (require_reboot) {
+    UI.toast("SD card config changed.\nRestart to apply.");
+  }
+
+  return true;
+}
+
+/**
+ * Saves whatever changed since the last save: now, at `save_at_ms`, or, with
+ * -1, whenever a queued save is due. The writing itself happens in the
+ * background, see ConfigStore.h; clients are sent just the changed keys.
+ */
 void saveConfigToSd(long save_at_ms) {
   static long save_at_ms_tick = 0;
-  String config;
 
   if (save_at_ms > 0) {
     // Queue a future save:
     save_at_ms_tick = max(save_at_ms, save_at_ms_tick);
     return;
   } else if (save_at_ms < 0) {
-    if (save_at_ms_tick > 0 && save_at_ms_tick < millis()) {
-      Serial.println(F("Saving now from future save queue..."));
+    const char *error = ConfigStore::takeError();
+    if (error != nullptr) {
+      UI.toast((String("Error ") + error).c_str());
+    }
+
+    if (applyConfigFromSd()) {
+      // Straight through, so the flash copy and clients catch up.
+    } else if (save_at_ms_tick > 0 && save_at_ms_tick < millis()) {
       save_at_ms_tick = 0;
     } else {
       return;
     }
   }
 
-  WebSocketHelper::sendSettings();
-
-  if (SD.exists(CONFIG_FILENAME)) {
-    SD.remove(CONFIG_FILENAME ".bak");
-    if (!SD.rename(CONFIG_FILENAME, CONFIG_FILENAME ".bak")) {
-      Serial.println(F("Failed to save over existing config!"));
-      UI.toast("Error " E_SAV_BAK);
-      return;
-    }
+  ConfigKeySet changed = ConfigStore::commit();
+  if (changed != 0) {
+    WebSocketHelper::sendSettingsChanged(changed);
   }
+}
 
-  SD.remove(CONFIG_FILENAME);
-  File tmp = SD.open(CONFIG_FILENAME, FILE_WRITE);
-  if (!tmp) {
-    Serial.println(F("Failed to create temp file for config save!"));
-    UI.toast("Error " E_SAV_TMP);
-    return;
+bool storeConfigValue(const char *option, const char *value, uint8_t &changed) {
+  if (!strcmp(option, "knob_rgb")) {
+    uint32_t color = strtoul(value, NULL, 16);
+    Hardware::setEncoderColor(CRGB(color));
+    return true;
   }
 
-  // Serialize and move temp file
-  if (!dumpConfigToJson(config)) {
-    Serial.println(F("Failed to serialize config to file!"));
-    UI.toast("Error " E_SAV_SER);
-    tmp.close();
+  const ConfigKey *key = ConfigSchema::find(option);
+  if (key == nullptr) {
+    return false;
   }
 
-  tmp.print(config);
-  tmp.close();
+  ConfigSchema::parse(*key, value);
+  changed |= key->flags;
+  return true;
 }
 
-bool setConfigValue(const char *option, const char *value, bool &require_reboot) {
-  if (!strcmp(option, "wifi_on")) {
-    Config.wifi_on = atob(value);
-    require_reboot = true;
-  } else if(!strcmp(option, "bt_on")) {
-    Config.bt_on = atob(value);
+void applyConfigChanges(uint8_t changed, bool &require_reboot) {
+  if (changed & CONFIG_REBOOT) {
     require_reboot = true;
-  } else if(!strcmp(option, "led_brightness")) {
-    Config.led_brightness = atoi(value);
-  } else if(!strcmp(option, "websocket_port")) {
-    Config.websocket_port = atoi(value);
-    require_reboot = true;
-  } else if(!strcmp(option, "motor_max_speed")) {
-    Config.motor_max_speed = atoi(value);
-  } else if(!strcmp(option, "screen_dim_seconds")) {
-    Config.screen_dim_seconds = atoi(value);
-  } else if(!strcmp(option, "screen_timeout_seconds")) {
-    Config.screen_timeout_seconds = atoi(value);
-  } else if(!strcmp(option, "pressure_smoothing")) {
-    Config.pressure_smoothing = atoi(value);
-  } else if(!strcmp(option, "classic_serial")) {
-    Config.classic_serial = atob(value);
-  } else if(!strcmp(option, "use_average_values")) {
-    Config.use_average_values = atob(value);
-  } else if(!strcmp(option, "sensitivity_threshold")) {
-    Config.sensitivity_threshold = atoi(value);
-  } else if(!strcmp(option, "motor_ramp_time_s")) {
-    Config.motor_ramp_time_s = atoi(value);
-  } else if(!strcmp(option, "update_frequency_hz")) {
-    Config.update_frequency_hz = atoi(value);
-  } else if(!strcmp(option, "sensor_sensitivity")) {
-    Config.sensor_sensitivity = atoi(value);
+  }
+
+  if (changed & CONFIG_MOTOR) {
+    MotorOutput::configChanged();
+  }
+
+  if (changed & CONFIG_ACCESSORIES) {
+    AccessoryLink::configChanged();
+  }
+
+  if (changed & CONFIG_SENSITIVITY) {
     Hardware::setPressureSensitivity(Config.sensor_sensitivity);
-  } else if (!strcmp(option, "knob_rgb")) {
-    uint32_t color = strtoul(value, NULL, 16);
-    Hardware::setEncoderColor(CRGB(color));
-  } else if (!strcmp(option, "wifi_ssid")) {
-    strlcpy(Config.wifi_ssid, value, sizeof(Config.wifi_ssid));
-  } else if (!strcmp(option, "wifi_key")) {
-    strlcpy(Config.wifi_key, value, sizeof(Config.wifi_key));
-  } else if (!strcmp(option, "bt_display_name")) {
-    strlcpy(Config.bt_display_name, value, sizeof(Config.bt_display_name));
-  } else {
+  }
+
+  if ((changed & CONFIG_CALIBRATION) && !Config.auto_calibrate) {
+    AutoCalibration::stop();
+  }
+
+  OrgasmControl::configChanged();
+}
+
+bool setConfigValue(const char *option, const char *value, bool &require_reboot) {
+  uint8_t changed = 0;
+
+  if (!storeConfigValue(option, value, changed)) {
     return false;
   }
 
+  applyConfigChanges(changed, require_reboot);
   return true;
 }
 
 bool getConfigValue(const char *option, String &out) {
-  if (!strcmp(option, "wifi_on")) {
-    out += String(Config.wifi_on) + '\n';
-  } else if(!strcmp(option, "bt_on")) {
-    out += String(Config.bt_on) + '\n';
-  } else if(!strcmp(option, "led_brightness")) {
-    out += String(Config.led_brightness) + '\n';
-  } else if(!strcmp(option, "websocket_port")) {
-    out += String(Config.websocket_port) + '\n';
-  } else if(!strcmp(option, "motor_max_speed")) {
-    out += String(Config.motor_max_speed) + '\n';
-  } else if(!strcmp(option, "screen_dim_seconds")) {
-    out += String(Config.screen_dim_seconds) + '\n';
-  } else if(!strcmp(option, "screen_timeout_seconds")) {
-    out += String(Config.screen_timeout_seconds) + '\n';
-  } else if(!strcmp(option, "pressure_smoothing")) {
-    out += String(Config.pressure_smoothing) + '\n';
-  } else if(!strcmp(option, "classic_serial")) {
-    out += String(Config.classic_serial) + '\n';
-  } else if(!strcmp(option, "use_average_values")) {
-    out += String(Config.use_average_values) + '\n';
-  } else if(!strcmp(option, "sensitivity_threshold")) {
-    out += String(Config.sensitivity_threshold) + '\n';
-  } else if(!strcmp(option, "motor_ramp_time_s")) {
-    out += String(Config.motor_ramp_time_s) + '\n';
-  } else if(!strcmp(option, "update_frequency_hz")) {
-    out += String(Config.update_frequency_hz) + '\n';
-  } else if(!strcmp(option, "sensor_sensitivity")) {
-    out += String(Config.sensor_sensitivity) + '\n';
-  } else if (!strcmp(option, "knob_rgb")) {
-    out += ("Usage: set knob_rgb 0xFFCCAA") + '\n';
-  } else if (!strcmp(option, "wifi_ssid")) {
-    out += String(Config.wifi_ssid) + '\n';
-  } else if (!strcmp(option, "wifi_key")) {
-    out += String(Config.wifi_key) + '\n';
-  } else if (!strcmp(option, "bt_display_name")) {
-    out += String(Config.bt_display_name) + '\n';
-  } else {
+  if (!strcmp(option, "knob_rgb")) {
+    out += String("Usage: set knob_rgb 0xFFCCAA") + '\n';
+    return true;
+  }
+
+  const ConfigKey *key = ConfigSchema::find(option);
+  if (key == nullptr) {
     return false;
   }
 
+  ConfigSchema::print(*key, out);
   return true;
-}
\ No newline at end of file
+}
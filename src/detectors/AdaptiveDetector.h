@@ -0,0 +1,64 @@
+#ifndef __d_ADAPTIVE_DETECTOR_h
+#define __d_ADAPTIVE_DETECTOR_h
+
+#include "../../include/ArousalDetector.h"
+
+// EMA weight for the noise estimate, as a right shift (1/64).
+#define ADAPTIVE_NOISE_SHIFT 6
+
+// Peaks must clear this many times the measured noise.
+#define ADAPTIVE_NOISE_MULT 4
+
+/**
+ * The peak detector, with the minimum peak height tracking the sensor's
+ * measured noise instead of a fixed tenth of the threshold. Quiet sensors
+ * pick up smaller contractions; noisy ones stop counting jitter as peaks.
+ */
+class AdaptiveDetector : public ArousalDetector {
+public:
+  const char *getName() override { return "adaptive"; }
+
+  void reset() override {
+    last_value = 4096;
+    peak_start = 0;
+    noise = 0;
+    primed = false;
+  }
+
+protected:
+  fixed_t detect(long p_check) override {
+    fixed_t added = 0;
+
+    // Mean absolute sample-to-sample change:
+    if (primed) {
+      fixed_t change = int_to_fixed(abs(p_check - last_value));
+      noise += (change - noise) >> ADAPTIVE_NOISE_SHIFT;
+    }
+    primed = true;
+
+    if (p_check < last_value) { // falling edge of peak
+      if (p_check > peak_start) { // first tick past peak?
+        long min_peak = max(
+            (long) fixed_to_int(noise * ADAPTIVE_NOISE_MULT),
+            (long) Config.sensitivity_threshold / 40
+        );
+
+        if (p_check - peak_start >= min_peak) {
+          added = int_to_fixed(p_check - peak_start);
+        }
+      }
+      peak_start = p_check;
+    }
+
+    last_value = p_check;
+    return added;
+  }
+
+private:
+  long last_value = 4096;
+  long peak_start = 0;
+  fixed_t noise = 0;
+  bool primed = false;
+};
+
+#endif
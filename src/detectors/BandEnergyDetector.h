@@ -0,0 +1,70 @@
+#ifndef __d_BAND_ENERGY_DETECTOR_h
+#define __d_BAND_ENERGY_DETECTOR_h
+
+#include "../../include/ArousalDetector.h"
+
+// Band-pass corners, as EMA time constants in milliseconds. Contractions
+// sit between them; sensor noise is faster, posture and drift are slower.
+#define BAND_FAST_MS 80
+#define BAND_SLOW_MS 640
+
+// Seconds of in-band energy that add one contraction's worth of arousal.
+#define BAND_WINDOW_S 0.1f
+
+/**
+ * Band-pass energy: the difference of a fast and a slow moving average
+ * keeps only contraction-speed movement. Its magnitude, above a noise
+ * floor, is integrated into arousal, so sustained clenching counts as well
+ * as sharp peaks.
+ */
+class BandEnergyDetector : public ArousalDetector {
+public:
+  const char *getName() override { return "band"; }
+
+  void reset() override {
+    primed = false;
+  }
+
+protected:
+  fixed_t detect(long pressure) override {
+    if (hz != Config.update_frequency_hz) {
+      updateConstants();
+    }
+
+    fixed_t p = int_to_fixed(pressure);
+    if (!primed) {
+      fast = slow = p;
+      primed = true;
+    }
+
+    fast += fixed_mul(p - fast, fast_alpha);
+    slow += fixed_mul(p - slow, slow_alpha);
+
+    fixed_t energy = abs(fast - slow) - int_to_fixed(Config.sensitivity_threshold / 20);
+    if (energy <= 0) {
+      return 0;
+    }
+
+    return fixed_mul(energy, gain);
+  }
+
+private:
+  int hz = 0;
+  bool primed = false;
+  fixed_t fast = 0;
+  fixed_t slow = 0;
+  fixed_t fast_alpha = 0;
+  fixed_t slow_alpha = 0;
+  fixed_t gain = 0;
+
+  void updateConstants() {
+    hz = Config.update_frequency_hz;
+    float rate = max(hz, 1);
+
+    fast_alpha = float_to_fixed(min(1.0f, 1000.0f / (BAND_FAST_MS * rate)));
+    slow_alpha = float_to_fixed(min(1.0f, 1000.0f / (BAND_SLOW_MS * rate)));
+    gain = float_to_fixed(1.0f / (BAND_WINDOW_S * rate));
+  }
+};
+
+#endif
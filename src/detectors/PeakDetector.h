@@ -0,0 +1,41 @@
+#ifndef __d_PEAK_DETECTOR_h
+#define __d_PEAK_DETECTOR_h
+
+#include "../../include/ArousalDetector.h"
+
+/**
+ * The original NoGasm heuristic: on the first falling sample after a rise,
+ * add the height of that rise if it's at least a tenth of the threshold.
+ */
+class PeakDetector : public ArousalDetector {
+public:
+  const char *getName() override { return "peak"; }
+
+  void reset() override {
+    last_value = 4096;
+    peak_start = 0;
+  }
+
+protected:
+  fixed_t detect(long p_check) override {
+    fixed_t added = 0;
+
+    if (p_check < last_value) { // falling edge of peak
+      if (p_check > peak_start) { // first tick past peak?
+        if (p_check - peak_start >= Config.sensitivity_threshold / 10) { // big peak
+          added = int_to_fixed(p_check - peak_start);
+        }
+      }
+      peak_start = p_check;
+    }
+
+    last_value = p_check;
+    return added;
+  }
+
+private:
+  long last_value = 4096;
+  long peak_start = 0;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef __d_SLOPE_DETECTOR_h
+#define __d_SLOPE_DETECTOR_h
+
+#include "../../include/ArousalDetector.h"
+
+// Samples between the two ends of the slope, to ride over sensor noise.
+#define SLOPE_SPAN 4
+
+/**
+ * Derivative based: every rise steeper than a noise floor adds to arousal
+ * as it happens, instead of waiting for the peak to fall. A full contraction
+ * adds about its height, like the peak detector, but sooner.
+ */
+class SlopeDetector : public ArousalDetector {
+public:
+  const char *getName() override { return "slope"; }
+
+  void reset() override {
+    index = 0;
+    filled = 0;
+  }
+
+protected:
+  fixed_t detect(long pressure) override {
+    long oldest = history[index];
+    history[index] = pressure;
+    index = (index + 1) % SLOPE_SPAN;
+
+    if (filled < SLOPE_SPAN) {
+      filled++;
+      return 0;
+    }
+
+    // Rise over the span, credited one sample's worth at a time:
+    long rise = pressure - oldest;
+    long floor = Config.sensitivity_threshold / 40;
+    if (rise <= floor) {
+      return 0;
+    }
+
+    return int_to_fixed(rise - floor) / SLOPE_SPAN;
+  }
+
+private:
+  long history[SLOPE_SPAN] = {0};
+  uint8_t index = 0;
+  uint8_t filled = 0;
+};
+
+#endif
@@ -19,11 +19,13 @@ UIInput MotorMaxSpeedInput("Motor Max Speed", [](UIMenu *ip) {
 
   input->onChange([](int value) {
     Config.motor_max_speed = value;
+    OrgasmControl::configChanged();
     Hardware::setMotorSpeed(value);
   });
 
   input->onConfirm([](int value) {
     Config.motor_max_speed = value;
+    OrgasmControl::configChanged();
     saveConfigToSd(0);
   });
 });
@@ -48,6 +50,7 @@ UIInput MotorRampTimeInput("Motor Ramp Time", [](UIMenu *ip) {
   input->setValue(Config.motor_ramp_time_s);
   input->onChange([](int value) {
     Config.motor_ramp_time_s = value;
+    OrgasmControl::configChanged();
   });
   input->onConfirm([](int) {
     saveConfigToSd(0);
@@ -61,7 +64,7 @@ UIInput SensorSensitivityInput("Sensor Sensitivity", [](UIMenu *ip) {
   input->setValue(Config.sensor_sensitivity);
   input->setPollPeriod(1000 / 30);
   input->getSecondaryValue([](int value) {
-    return Hardware::getPressure();
+    return OrgasmControl::getLastPressure();
   });
   input->onChange([](int value) {
     Config.sensor_sensitivity = value;
@@ -77,6 +80,7 @@ static void buildMenu(UIMenu *menu) {
   menu->addItem(&MotorRampTimeInput);
   menu->addItem(&ArousalLimitInput);
   menu->addItem(&SensorSensitivityInput);
+  menu->addItem(&MotorPatternMenu);
 }
 
 UIMenu EdgingSettingsMenu("Edging Settings", &buildMenu);
\ No newline at end of file
@@ -0,0 +1,23 @@
+#include "../../include/UIMenu.h"
+#include "../../include/UserInterface.h"
+#include "../../include/OrgasmControl.h"
+#include "../../include/MotorPattern.h"
+
+/**
+ * One entry per pattern, built-in or from the SD card, rebuilt whenever the
+ * menu opens. Picking one saves it as motor_pattern.
+ */
+static void buildMenu(UIMenu *menu) {
+  for (size_t i = 0; i < MotorPatterns::count(); i++) {
+    const MotorPattern *pattern = MotorPatterns::get(i);
+
+    menu->addItem((char*) pattern->name, [=](UIMenu*) {
+      strlcpy(Config.motor_pattern, pattern->name, sizeof(Config.motor_pattern));
+      OrgasmControl::configChanged();
+      saveConfigToSd(0);
+      UI.toast((String("Motor pattern:\n") + pattern->name).c_str());
+    });
+  }
+}
+
+UIMenu MotorPatternMenu("Motor Pattern", &buildMenu);
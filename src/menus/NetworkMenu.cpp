@@ -20,36 +20,42 @@ static void onEnableWiFi(UIMenu *menu) {
     return;
   }
 
-  UI.toastNow("Connecting...", 0, false);
+  // It connects in the background, and keeps trying:
   Config.wifi_on = true;
-  if (WiFiHelper::begin()) {
-    UI.toastNow("WiFi Connected!", 3000);
-    saveConfigToSd(0);
-    menu->initialize();
-  } else {
-    UI.toastNow("Failed to connect.", 3000);
-    Config.wifi_on = false;
-  }
+  saveConfigToSd(0);
+  WiFiHelper::begin();
+  UI.toast("Connecting...", 3000);
 
+  menu->initialize();
   menu->render();
 }
 
 static void onViewStatus(UIMenu*) {
   String status = "";
 
-  if (WiFiHelper::connected()) {
-    status += "Connected";
-    status += "\n" + WiFiHelper::ip();
-    status += "\nSignal: " + WiFiHelper::signalStrengthStr();
-  } else {
-    status += "Disconnected";
+  switch (WiFiHelper::getState()) {
+    case WiFiConnected:
+      status += "Connected";
+      status += "\n" + WiFiHelper::ip();
+      status += "\nSignal: " + WiFiHelper::signalStrengthStr();
+      break;
+    case WiFiConnecting:
+      status += "Connecting...";
+      break;
+    case WiFiWaiting:
+      status += "Disconnected";
+      status += "\nRetrying soon.";
+      break;
+    default:
+      status += "Disconnected";
+      break;
   }
 
   UI.toast(status.c_str(), 0);
 }
 
 static void buildMenu(UIMenu *menu) {
-  if (WiFiHelper::connected()) {
+  if (Config.wifi_on) {
     menu->addItem("Disable WiFi", &onDisableWiFi);
   } else {
     menu->addItem("Enable WiFi", &onEnableWiFi);
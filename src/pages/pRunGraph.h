@@ -7,6 +7,7 @@
 #include "../../include/Hardware.h"
 #include "../../include/assets.h"
 #include "../../include/WebSocketHelper.h"
+#include "../../include/ConfigSchema.h"
 
 enum RGView {
   GraphView,
@@ -50,6 +51,12 @@ class pRunGraph : public Page {
     }
   }
 
+  void selectPattern(const MotorPattern *pattern) {
+    strlcpy(Config.motor_pattern, pattern->name, sizeof(Config.motor_pattern));
+    OrgasmControl::configChanged();
+    saveConfigToSd(millis() + 300);
+  }
+
   void renderChart() {
     // Update Counts
     char status[7] = "";
@@ -176,8 +183,8 @@ class pRunGraph : public Page {
     const int step = 255 / 20;
 
     if (mode == Automatic) {
-      // TODO this may go out of bounds. Also, change in steps?
-      Config.sensitivity_threshold += (diff * step);
+      ConfigSchema::setLong(*ConfigSchema::find("sensitivity_threshold"),
+                            Config.sensitivity_threshold + (diff * step));
       saveConfigToSd(millis() + 300);
     } else {
       Hardware::changeMotorSpeed(diff * step);
@@ -194,6 +201,10 @@ public:
     } else if (! strcmp(newMode, "manual")) {
       mode = Manual;
       OrgasmControl::controlMotor(false);
+    } else if (MotorPatterns::find(newMode) != nullptr) {
+      selectPattern(MotorPatterns::find(newMode));
+      mode = Automatic;
+      OrgasmControl::controlMotor(true);
     }
 
     updateButtons();